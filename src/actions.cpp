@@ -20,6 +20,7 @@
 
 #include <cassert>
 #include <cerrno>
+#include <chrono>
 #include <cstring>
 #include <boost/date_time/posix_time/posix_time.hpp>
 #include <boost/filesystem/operations.hpp>
@@ -313,13 +314,12 @@ std::shared_ptr<BaseAction> get_(const std::string &name)
 
 UpdateEnvironment::UpdateEnvironment()
 : BaseAction(Type::UpdateEnvironment, "update_environment")
-, m_past(boost::posix_time::from_time_t(0))
+, m_header_update_requested(false)
+, m_header_timer(0)
 { }
 
 void UpdateEnvironment::run(bool update_timer, bool refresh_window, bool mpd_sync)
 {
-	using Global::Timer;
-
 	// update timer, status if necessary etc.
 	Status::trace(update_timer, true);
 
@@ -327,13 +327,27 @@ void UpdateEnvironment::run(bool update_timer, bool refresh_window, bool mpd_syn
 	if (auto message = myLyrics->tryTakeConsumerMessage())
 		Statusbar::print(*message);
 
-	// header stuff
-	if ((myScreen == myPlaylist || myScreen == myBrowser || myScreen == myLyrics)
-	&&  (Timer - m_past > boost::posix_time::milliseconds(500))
-	)
+	// header stuff, scroll it only while it's displayed
+	auto &loop = Global::wFooter->eventLoop();
+	if (myScreen == myPlaylist || myScreen == myBrowser || myScreen == myLyrics)
+	{
+		if (m_header_timer == 0)
+		{
+			m_header_update_requested = true;
+			m_header_timer = loop.addPeriodicTimer(std::chrono::milliseconds(500), [this] {
+				m_header_update_requested = true;
+			});
+		}
+	}
+	else if (m_header_timer != 0)
+	{
+		loop.cancelTimer(m_header_timer);
+		m_header_timer = 0;
+	}
+	if (m_header_update_requested)
 	{
 		drawHeader();
-		m_past = Timer;
+		m_header_update_requested = false;
 	}
 
 	if (refresh_window)
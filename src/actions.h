@@ -21,7 +21,6 @@
 #ifndef NCMPCPP_ACTIONS_H
 #define NCMPCPP_ACTIONS_H
 
-#include <boost/date_time/posix_time/posix_time_types.hpp>
 #include <boost/format.hpp>
 #include <map>
 #include <string>
@@ -239,7 +238,8 @@ struct UpdateEnvironment: BaseAction
 	void run(bool update_status, bool refresh_window, bool mpd_sync);
 
 private:
-	boost::posix_time::ptime m_past;
+	bool m_header_update_requested;
+	NC::EventLoop::TimerID m_header_timer;
 
 	virtual void run() override;
 };
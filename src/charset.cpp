@@ -21,6 +21,7 @@
 #include <boost/locale.hpp>
 #include "charset.h"
 #include "settings.h"
+#include "utility/wide_string.h"
 
 namespace Charset {
 
@@ -54,32 +55,55 @@ std::string fromUtf8To(const std::string &s, const char *charset)
 	return boost::locale::conv::to_utf<char>(s, charset);
 }
 
+bool isIdentityConversion()
+{
+	// system_encoding is cleared during configuration parsing if the locale
+	// charset is UTF-8, so empty value means there is nothing to convert.
+	return Config.system_encoding.empty();
+}
+
 std::string utf8ToLocale(const std::string &s)
 {
-	return Config.system_encoding.empty()
+	return isIdentityConversion()
 	     ? s
 	     : boost::locale::conv::from_utf<char>(s, Config.system_encoding);
 }
 
 std::string localeToUtf8(const std::string &s)
 {
-	return Config.system_encoding.empty()
+	return isIdentityConversion()
 	     ? s
 	     : boost::locale::conv::to_utf<char>(s, Config.system_encoding);
 }
 
 std::string utf8ToLocale(std::string &&s)
 {
-	if (!Config.system_encoding.empty())
+	if (!isIdentityConversion())
 		s = boost::locale::conv::from_utf<char>(s, Config.system_encoding);
 	return std::move(s);
 }
 
 std::string localeToUtf8(std::string &&s)
 {
-	if (!Config.system_encoding.empty())
+	if (!isIdentityConversion())
 		s = boost::locale::conv::to_utf<char>(s, Config.system_encoding);
 	return std::move(s);
 }
 
+const std::string &utf8ToLocale(const std::string &s, std::string &buffer)
+{
+	if (isIdentityConversion())
+		return s;
+	buffer = boost::locale::conv::from_utf<char>(s, Config.system_encoding);
+	return buffer;
+}
+
+void utf8ToLocaleWide(std::wstring &ws, const std::string &s)
+{
+	if (isIdentityConversion())
+		utf8ToWide(ws, s);
+	else
+		ws = ToWString(boost::locale::conv::from_utf<char>(s, Config.system_encoding));
+}
+
 }
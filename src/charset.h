@@ -31,11 +31,23 @@ std::locale internalLocale();
 std::string toUtf8From(const std::string &s, const char *charset);
 std::string fromUtf8To(const std::string &s, const char *charset);
 
+// True if the terminal uses UTF-8, i.e. conversions between utf8 and locale
+// charset are no-ops and can be skipped altogether.
+bool isIdentityConversion();
+
 std::string utf8ToLocale(const std::string &s);
 std::string utf8ToLocale(std::string &&s);
 std::string localeToUtf8(const std::string &s);
 std::string localeToUtf8(std::string &&s);
 
+// Returns s if no conversion is needed, otherwise converts it into buffer and
+// returns the buffer, so that the common case doesn't allocate.
+const std::string &utf8ToLocale(const std::string &s, std::string &buffer);
+
+// Equivalent of ToWString(utf8ToLocale(s)) that decodes the string directly
+// if the conversion to locale charset is a no-op.
+void utf8ToLocaleWide(std::wstring &ws, const std::string &s);
+
 }
 
 #endif // NCMPCPP_CHARSET_H
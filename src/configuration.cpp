@@ -22,16 +22,23 @@
 #include <boost/algorithm/string/trim.hpp>
 #include <boost/filesystem/operations.hpp>
 #include <boost/program_options.hpp>
+#include <chrono>
 #include <iomanip>
 #include <iostream>
 #include <fstream>
+#include <iterator>
 
 #include "bindings.h"
 #include "configuration.h"
 #include "config.h"
+#include "curl_handle.h"
+#include "lastfm_service.h"
 #include "mpdpp.h"
 #include "format_impl.h"
+#include "lyrics_store.h"
+#include "screens/visualizer.h"
 #include "settings.h"
+#include "utility/local_http_server.h"
 #include "utility/string.h"
 
 namespace po = boost::program_options;
@@ -94,6 +101,12 @@ bool configure(int argc, char **argv)
 		("config,c", po::value<std::vector<std::string>>(&config_paths)->value_name("PATH")->default_value(default_config_paths, join<std::string>(default_config_paths, " AND ")), "specify configuration file(s)")
 		("ignore-config-errors", "ignore unknown and invalid options in configuration files")
 		("test-lyrics-fetchers", "check if lyrics fetchers work")
+		("record-responses", po::value<std::string>()->value_name("DIR"), "with --test-lyrics-fetchers, save responses of servers into directory")
+		("replay-responses", po::value<std::string>()->value_name("DIR"), "with --test-lyrics-fetchers, serve responses saved in directory from a local server")
+		("replay-latency", po::value<unsigned>()->value_name("MS")->default_value(0), "delay responses of the local server")
+		("replay-failure-rate", po::value<unsigned>()->value_name("PERCENT")->default_value(0), "make given percentage of requests to the local server fail")
+		("import-lyrics", "copy lyrics files from lyrics directory into the single file and exit")
+		("export-lyrics", "copy lyrics from the single file into files in lyrics directory and exit")
 		("bindings,b", po::value<std::vector<std::string>>(&bindings_paths)->value_name("PATH")->default_value(default_bindings_paths, join<std::string>(default_bindings_paths, " AND ")), "specify bindings file(s)")
 		("screen,s", po::value<std::string>()->value_name("SCREEN"), "specify the startup screen")
 		("slave-screen,S", po::value<std::string>()->value_name("SCREEN"), "specify the startup slave screen")
@@ -101,6 +114,11 @@ bool configure(int argc, char **argv)
 		("version,v", "display version information")
 		("quiet,q", "suppress logs and excess output")
 	;
+#	ifdef ENABLE_VISUALIZER
+	options.add_options()
+		("benchmark-visualizer", "measure rendering performance of the visualizer and exit")
+	;
+#	endif // ENABLE_VISUALIZER
 
 	po::variables_map vm;
 	try
@@ -167,18 +185,60 @@ bool configure(int argc, char **argv)
 				std::make_tuple("tekstowo", "rihanna", "umbrella"),
 				std::make_tuple("zeneszoveg", "rihanna", "umbrella"),
 			};
-			for (auto &data : fetcher_data)
+
+			// Responses can be recorded once and then replayed by a local
+			// server, so that fetchers can be checked without network access.
+			std::unique_ptr<LocalHTTPServer> server;
+			if (vm.count("record-responses"))
 			{
-				auto fetcher = boost::lexical_cast<LyricsFetcher_>(std::get<0>(data));
+				auto directory = vm["record-responses"].as<std::string>();
+				boost::filesystem::create_directories(directory);
+				Curl::setRecordDirectory(directory);
+			}
+			if (vm.count("replay-responses"))
+			{
+				auto directory = vm["replay-responses"].as<std::string>();
+				server = std::make_unique<LocalHTTPServer>(
+					[directory](const std::string &target) {
+						boost::optional<std::string> body;
+						std::ifstream input(directory + "/" + Curl::recordName(target),
+						                    std::ios::binary);
+						if (input.is_open())
+							body = std::string(std::istreambuf_iterator<char>(input),
+							                   std::istreambuf_iterator<char>());
+						return body;
+					},
+					vm["replay-latency"].as<unsigned>(),
+					vm["replay-failure-rate"].as<unsigned>());
+				server->start();
+				Curl::setURLBase(server->url());
+			}
+
+			auto report = [](const char *name, auto fetch) {
 				std::cout << std::setw(20)
 				          << std::left
-				          << fetcher->name()
+				          << name
 				          << " : "
 				          << std::flush;
-				auto result = fetcher->fetch(std::get<1>(data), std::get<2>(data));
-				std::cout << (result.first ? "ok" : "failed")
-				          << "\n";
+				auto start = std::chrono::steady_clock::now();
+				bool ok = fetch();
+				auto elapsed = std::chrono::steady_clock::now() - start;
+				std::cout << std::setw(6)
+				          << (ok ? "ok" : "failed")
+				          << " ("
+				          << std::chrono::duration_cast<std::chrono::milliseconds>(elapsed).count()
+				          << " ms)\n";
+			};
+			for (auto &data : fetcher_data)
+			{
+				auto fetcher = boost::lexical_cast<LyricsFetcher_>(std::get<0>(data));
+				report(fetcher->name(), [&] {
+					return fetcher->fetch(std::get<1>(data), std::get<2>(data)).first;
+				});
 			}
+			report("last.fm", [] {
+				return LastFm::ArtistInfo("rihanna", "en").fetch().first;
+			});
 			exit(0);
 		}
 
@@ -205,6 +265,31 @@ bool configure(int argc, char **argv)
 		boost::filesystem::create_directories(Config.ncmpcpp_directory);
 		boost::filesystem::create_directory(Config.lyrics_directory);
 
+		if (Config.store_lyrics_in_single_file
+		    || vm.count("import-lyrics")
+		    || vm.count("export-lyrics"))
+			LyricsDB.open(Config.lyrics_directory);
+		if (vm.count("import-lyrics"))
+		{
+			auto n = LyricsDB.importFiles(Config.lyrics_directory);
+			std::cout << "Imported " << n << " lyrics into " << LyricsDB.path() << "\n";
+			exit(0);
+		}
+		if (vm.count("export-lyrics"))
+		{
+			auto n = LyricsDB.exportFiles(Config.lyrics_directory);
+			std::cout << "Exported " << n << " lyrics from " << LyricsDB.path() << "\n";
+			exit(0);
+		}
+
+#		ifdef ENABLE_VISUALIZER
+		if (vm.count("benchmark-visualizer"))
+		{
+			Visualizer::Benchmark();
+			exit(0);
+		}
+#		endif // ENABLE_VISUALIZER
+
 		// try to get MPD connection details from environment variables
 		// as they take precedence over these from the configuration.
 		auto env_host = getenv("MPD_HOST");
@@ -20,10 +20,104 @@
 
 #include "curl_handle.h"
 
+#include <array>
 #include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <vector>
+#include "utility/string.h"
 
 namespace
 {
+	// DNS cache, TLS sessions and connections are shared between all handles
+	// and idle handles are kept around, so that consecutive requests to the
+	// same host don't need to redo lookups and handshakes.
+	struct HandlePool
+	{
+		HandlePool()
+		{
+			m_share = curl_share_init();
+			curl_share_setopt(m_share, CURLSHOPT_LOCKFUNC, lock);
+			curl_share_setopt(m_share, CURLSHOPT_UNLOCKFUNC, unlock);
+			curl_share_setopt(m_share, CURLSHOPT_USERDATA, this);
+			curl_share_setopt(m_share, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+			curl_share_setopt(m_share, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+#			if LIBCURL_VERSION_NUM >= 0x073900
+			curl_share_setopt(m_share, CURLSHOPT_SHARE, CURL_LOCK_DATA_CONNECT);
+#			endif // LIBCURL_VERSION_NUM
+		}
+
+		CURL *acquire()
+		{
+			CURL *c = nullptr;
+			{
+				std::lock_guard<std::mutex> lock(m_mutex);
+				if (!m_idle.empty())
+				{
+					c = m_idle.back();
+					m_idle.pop_back();
+				}
+			}
+			if (c == nullptr)
+				c = curl_easy_init();
+			curl_easy_setopt(c, CURLOPT_SHARE, m_share);
+			return c;
+		}
+
+		void release(CURL *c)
+		{
+			// Options are reset, but connections and caches are kept.
+			curl_easy_reset(c);
+			{
+				std::lock_guard<std::mutex> lock(m_mutex);
+				if (m_idle.size() < MaxIdle)
+				{
+					m_idle.push_back(c);
+					return;
+				}
+			}
+			curl_easy_cleanup(c);
+		}
+
+	private:
+		static void lock(CURL *, curl_lock_data data, curl_lock_access, void *pool)
+		{
+			static_cast<HandlePool *>(pool)->m_share_mutexes[data].lock();
+		}
+
+		static void unlock(CURL *, curl_lock_data data, void *pool)
+		{
+			static_cast<HandlePool *>(pool)->m_share_mutexes[data].unlock();
+		}
+
+		static const size_t MaxIdle = 8;
+
+		CURLSH *m_share;
+		std::array<std::mutex, CURL_LOCK_DATA_LAST> m_share_mutexes;
+
+		std::mutex m_mutex;
+		std::vector<CURL *> m_idle;
+	};
+
+	// Never destroyed as transfers might still be in progress in other threads
+	// when the program exits.
+	HandlePool &pool()
+	{
+		static HandlePool *p = new HandlePool;
+		return *p;
+	}
+
+	std::string url_base;
+	std::string record_directory;
+
+	// Host and path of the URL, without the scheme.
+	std::string stripScheme(const std::string &URL)
+	{
+		size_t i = URL.find("://");
+		return i == std::string::npos ? URL : URL.substr(i + 3);
+	}
+
 	size_t write_data(char *buffer, size_t size, size_t nmemb, void *data)
 	{
 		size_t result = size*nmemb;
@@ -32,24 +126,51 @@ namespace
 	}
 }
 
-CURLcode Curl::perform(std::string &data, const std::string &URL, const std::string &referer, bool follow_redirect, unsigned timeout)
+CURL *Curl::createHandle(std::string &data, const std::string &URL, const std::string &referer, bool follow_redirect, unsigned timeout)
 {
-	CURLcode result;
-	CURL *c = curl_easy_init();
-	curl_easy_setopt(c, CURLOPT_URL, URL.c_str());
+	CURL *c = pool().acquire();
+	if (url_base.empty())
+		curl_easy_setopt(c, CURLOPT_URL, URL.c_str());
+	else
+		curl_easy_setopt(c, CURLOPT_URL, (url_base + "/" + stripScheme(URL)).c_str());
 	curl_easy_setopt(c, CURLOPT_WRITEFUNCTION, write_data);
 	curl_easy_setopt(c, CURLOPT_WRITEDATA, &data);
 	curl_easy_setopt(c, CURLOPT_CONNECTTIMEOUT, timeout);
 	curl_easy_setopt(c, CURLOPT_NOSIGNAL, 1);
+	// When recording or replaying responses, treat error pages as failures so
+	// that they are not recorded and injected failures are reported as such.
+	// Otherwise fetchers handle them on their own.
+	if (!url_base.empty() || !record_directory.empty())
+		curl_easy_setopt(c, CURLOPT_FAILONERROR, 1L);
 	if (follow_redirect)
 		curl_easy_setopt(c, CURLOPT_FOLLOWLOCATION, 1L);
 	if (!referer.empty())
 		curl_easy_setopt(c, CURLOPT_REFERER, referer.c_str());
+	return c;
+}
+
+CURLcode Curl::perform(std::string &data, const std::string &URL, const std::string &referer, bool follow_redirect, unsigned timeout)
+{
+	CURLcode result;
+	CURL *c = createHandle(data, URL, referer, follow_redirect, timeout);
 	result = curl_easy_perform(c);
-	curl_easy_cleanup(c);
+	releaseHandle(c);
+	if (result == CURLE_OK && !record_directory.empty())
+	{
+		auto filename = record_directory + "/" + recordName(URL);
+		std::ofstream output(filename, std::ios::binary);
+		output << data;
+		if (!output)
+			std::cerr << "Couldn't record response to " << URL << " in " << filename << "\n";
+	}
 	return result;
 }
 
+void Curl::releaseHandle(CURL *c)
+{
+	pool().release(c);
+}
+
 std::string Curl::escape(const std::string &s)
 {
 	char *cs = curl_easy_escape(0, s.c_str(), s.length());
@@ -57,3 +178,18 @@ std::string Curl::escape(const std::string &s)
 	curl_free(cs);
 	return result;
 }
+
+void Curl::setURLBase(std::string base)
+{
+	url_base = std::move(base);
+}
+
+void Curl::setRecordDirectory(std::string directory)
+{
+	record_directory = std::move(directory);
+}
+
+std::string Curl::recordName(const std::string &URL)
+{
+	return hashString(stripScheme(URL));
+}
@@ -28,9 +28,28 @@
 
 namespace Curl
 {
+	// Creates a handle for fetching URL into data, to be used with the multi
+	// interface. It needs to be given back with releaseHandle.
+	CURL *createHandle(std::string &data, const std::string &URL, const std::string &referer = "", bool follow_redirect = false, unsigned timeout = 10);
+	void releaseHandle(CURL *c);
+
 	CURLcode perform(std::string &data, const std::string &URL, const std::string &referer = "", bool follow_redirect = false, unsigned timeout = 10);
 	
 	std::string escape(const std::string &s);
+
+	// Send all requests to the server at base instead, with the host and
+	// path of the original URL as the path, e.g. https://genius.com/song
+	// becomes http://127.0.0.1:8000/genius.com/song for base equal to
+	// http://127.0.0.1:8000. Used for testing, needs to be set at startup.
+	void setURLBase(std::string base);
+
+	// Save bodies of successful responses to requests made with perform into
+	// files in the directory. Used for testing, needs to be set at startup.
+	void setRecordDirectory(std::string directory);
+
+	// Name of the file into which the response to the URL is saved. Requests
+	// that differ only in the scheme share the same file.
+	std::string recordName(const std::string &URL);
 }
 
 #endif // NCMPCPP_CURL_HANDLE_H
@@ -0,0 +1,243 @@
+/***************************************************************************
+ *   Copyright (C) 2008-2021 by Andrzej Rybczak                            *
+ *   andrzej@rybczak.net                                                   *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.              *
+ ***************************************************************************/
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdexcept>
+#include <unistd.h>
+
+#include "curses/event_loop.h"
+#include "gcc.h"
+
+#ifdef HAVE_SYS_EPOLL_H
+# include <sys/epoll.h>
+#endif // HAVE_SYS_EPOLL_H
+
+#ifdef HAVE_SYS_EVENTFD_H
+# include <sys/eventfd.h>
+#endif // HAVE_SYS_EVENTFD_H
+
+namespace NC {
+
+EventLoop::EventLoop()
+{
+#ifdef HAVE_SYS_EVENTFD_H
+	m_wakeup_fds[0] = m_wakeup_fds[1] = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	if (m_wakeup_fds[0] < 0)
+		throw std::runtime_error("eventfd failed");
+#else
+	if (pipe(m_wakeup_fds) < 0)
+		throw std::runtime_error("pipe failed");
+	// pipe stores read end first, but we want to write into the first one
+	std::swap(m_wakeup_fds[0], m_wakeup_fds[1]);
+	for (int fd : m_wakeup_fds)
+	{
+		fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+		fcntl(fd, F_SETFD, FD_CLOEXEC);
+	}
+#endif // HAVE_SYS_EVENTFD_H
+
+#ifdef HAVE_SYS_EPOLL_H
+	m_epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+	if (m_epoll_fd < 0)
+		throw std::runtime_error("epoll_create1 failed");
+#endif // HAVE_SYS_EPOLL_H
+
+	addSource(m_wakeup_fds[1], std::bind(&EventLoop::drainWakeup, this));
+}
+
+EventLoop::~EventLoop()
+{
+#ifdef HAVE_SYS_EPOLL_H
+	close(m_epoll_fd);
+#endif // HAVE_SYS_EPOLL_H
+	close(m_wakeup_fds[0]);
+	if (m_wakeup_fds[1] != m_wakeup_fds[0])
+		close(m_wakeup_fds[1]);
+}
+
+void EventLoop::addSource(int fd, Callback callback)
+{
+	auto it = std::find_if(m_sources.begin(), m_sources.end(), [fd](const Source &s) {
+		return s.fd == fd;
+	});
+	if (it != m_sources.end())
+	{
+		it->callback = std::move(callback);
+		return;
+	}
+	m_sources.emplace_back(fd, std::move(callback));
+
+#ifdef HAVE_SYS_EPOLL_H
+	epoll_event ev = {};
+	ev.events = EPOLLIN;
+	ev.data.fd = fd;
+	// The descriptor might have been closed and reopened without being removed
+	// from the list (e.g. after reconnection to MPD), in which case it's still
+	// registered in the kernel.
+	if (epoll_ctl(m_epoll_fd, EPOLL_CTL_ADD, fd, &ev) < 0 && errno == EEXIST)
+		epoll_ctl(m_epoll_fd, EPOLL_CTL_MOD, fd, &ev);
+#endif // HAVE_SYS_EPOLL_H
+}
+
+void EventLoop::removeSource(int fd)
+{
+	auto it = std::find_if(m_sources.begin(), m_sources.end(), [fd](const Source &s) {
+		return s.fd == fd;
+	});
+	if (it == m_sources.end())
+		return;
+	m_sources.erase(it);
+	m_ready.erase(std::remove(m_ready.begin(), m_ready.end(), fd), m_ready.end());
+
+#ifdef HAVE_SYS_EPOLL_H
+	// Fails if the descriptor was already closed, which is fine.
+	epoll_ctl(m_epoll_fd, EPOLL_CTL_DEL, fd, nullptr);
+#endif // HAVE_SYS_EPOLL_H
+}
+
+void EventLoop::clearSources()
+{
+	// remove all, but the internal one
+	while (m_sources.size() > 1)
+		removeSource(m_sources.back().fd);
+}
+
+bool EventLoop::hasSource(int fd) const
+{
+	return std::any_of(m_sources.begin(), m_sources.end(), [fd](const Source &s) {
+		return s.fd == fd;
+	});
+}
+
+EventLoop::TimerID EventLoop::addTimer(std::chrono::milliseconds delay, Callback callback)
+{
+	return m_timers.add(delay, std::move(callback));
+}
+
+EventLoop::TimerID EventLoop::addPeriodicTimer(std::chrono::milliseconds interval, Callback callback)
+{
+	return m_timers.add(interval, std::move(callback), interval);
+}
+
+void EventLoop::cancelTimer(TimerID id)
+{
+	m_timers.cancel(id);
+	// The timer might have expired during the last wait(), in which case its
+	// callback is waiting for dispatch().
+	m_cancelled.push_back(id);
+}
+
+bool EventLoop::wait(int timeout)
+{
+	m_ready.clear();
+	m_cancelled.clear();
+	// don't sleep past the nearest deadline
+	int timers_timeout = m_timers.timeout();
+	if (timers_timeout >= 0 && (timeout < 0 || timers_timeout < timeout))
+		timeout = timers_timeout;
+#ifdef HAVE_SYS_EPOLL_H
+	epoll_event events[16];
+	int res = epoll_wait(m_epoll_fd, events, sizeof(events)/sizeof(*events), timeout);
+	for (int i = 0; i < res; ++i)
+		m_ready.push_back(events[i].data.fd);
+#else
+	std::vector<pollfd> fds;
+	fds.reserve(m_sources.size());
+	for (const auto &source : m_sources)
+		fds.push_back({ source.fd, POLLIN, 0 });
+	int res = poll(fds.data(), fds.size(), timeout);
+	if (res > 0)
+	{
+		for (const auto &fd : fds)
+			if (fd.revents & (POLLIN | POLLHUP | POLLERR))
+				m_ready.push_back(fd.fd);
+	}
+#endif // HAVE_SYS_EPOLL_H
+	m_timers.advance(m_expired);
+	return !m_ready.empty() || !m_expired.empty();
+}
+
+bool EventLoop::isReady(int fd) const
+{
+	return std::find(m_ready.begin(), m_ready.end(), fd) != m_ready.end();
+}
+
+void EventLoop::dispatch()
+{
+	// Callbacks might modify the list of sources, so copy the ones to invoke.
+	std::vector<Callback> callbacks;
+	for (const auto &source : m_sources)
+		if (source.callback && isReady(source.fd))
+			callbacks.push_back(source.callback);
+	m_ready.clear();
+	TimerWheel::Expired expired;
+	expired.swap(m_expired);
+	for (const auto &callback : callbacks)
+		callback();
+	// Callbacks of timers are invoked last and one by one, as any of the
+	// previous callbacks might have cancelled them.
+	for (const auto &timer : expired)
+	{
+		if (std::find(m_cancelled.begin(), m_cancelled.end(), timer.first) == m_cancelled.end())
+			timer.second();
+	}
+}
+
+void EventLoop::wakeup()
+{
+#ifdef HAVE_SYS_EVENTFD_H
+	uint64_t value = 1;
+#else
+	char value = 0;
+#endif // HAVE_SYS_EVENTFD_H
+	// If it fails, the counter is saturated or the pipe is full, so there is
+	// already a pending wakeup anyway.
+	GNUC_UNUSED ssize_t written = write(m_wakeup_fds[0], &value, sizeof(value));
+}
+
+void EventLoop::post(Callback callback)
+{
+	{
+		std::lock_guard<std::mutex> lock(m_posted_mutex);
+		m_posted.push_back(std::move(callback));
+	}
+	wakeup();
+}
+
+void EventLoop::drainWakeup()
+{
+	char buf[64];
+	while (read(m_wakeup_fds[1], buf, sizeof(buf)) > 0) { }
+	// Callbacks posted after the descriptor was drained are either taken here
+	// or their wakeup makes it readable again.
+	std::vector<Callback> posted;
+	{
+		std::lock_guard<std::mutex> lock(m_posted_mutex);
+		posted.swap(m_posted);
+	}
+	for (const auto &callback : posted)
+		callback();
+}
+
+}
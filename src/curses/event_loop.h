@@ -0,0 +1,137 @@
+/***************************************************************************
+ *   Copyright (C) 2008-2021 by Andrzej Rybczak                            *
+ *   andrzej@rybczak.net                                                   *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.              *
+ ***************************************************************************/
+
+#ifndef NCMPCPP_EVENT_LOOP_H
+#define NCMPCPP_EVENT_LOOP_H
+
+#include "config.h"
+
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+#include "utility/timer_wheel.h"
+
+namespace NC {
+
+/// Waits for file descriptors to become readable or timers to expire and
+/// dispatches callbacks associated with them. Uses epoll if it's available
+/// and poll otherwise.
+struct EventLoop
+{
+	typedef std::function<void()> Callback;
+	typedef TimerWheel::TimerID TimerID;
+
+	EventLoop();
+	~EventLoop();
+
+	EventLoop(const EventLoop &) = delete;
+	EventLoop &operator=(const EventLoop &) = delete;
+
+	/// Registers file descriptor to be watched
+	/// @param fd file descriptor
+	/// @param callback function invoked by dispatch() when there is data
+	/// waiting for reading in fd. If it's empty, the source is passive and its
+	/// state can only be checked with isReady().
+	void addSource(int fd, Callback callback);
+
+	/// Unregisters file descriptor
+	void removeSource(int fd);
+
+	/// Unregisters all file descriptors
+	void clearSources();
+
+	/// @return true if file descriptor is registered
+	bool hasSource(int fd) const;
+
+	/// @return number of registered file descriptors
+	size_t sources() const { return m_sources.size() - 1; }
+
+	/// Schedules callback to be invoked by dispatch() once after delay
+	/// @return identifier of the timer
+	TimerID addTimer(std::chrono::milliseconds delay, Callback callback);
+
+	/// Schedules callback to be invoked by dispatch() every interval
+	/// @return identifier of the timer
+	TimerID addPeriodicTimer(std::chrono::milliseconds interval, Callback callback);
+
+	/// Cancels the timer. Does nothing if its callback was already invoked.
+	void cancelTimer(TimerID id);
+
+	/// Waits until any of registered file descriptors becomes readable,
+	/// a timer expires, wakeup() is called or timeout expires
+	/// @param timeout timeout in milliseconds, negative value means infinity
+	/// @return true if any file descriptor is ready or any timer expired
+	bool wait(int timeout);
+
+	/// @return true if file descriptor was readable after last wait()
+	bool isReady(int fd) const;
+
+	/// Invokes callbacks of file descriptors that were ready and timers that
+	/// expired during last wait()
+	void dispatch();
+
+	/// Interrupts wait(). Safe to call from other threads.
+	void wakeup();
+
+	/// Schedules callback to be invoked by dispatch() after the next wait().
+	/// Safe to call from other threads, used for passing results of
+	/// background jobs to the thread running the loop.
+	void post(Callback callback);
+
+private:
+	struct Source
+	{
+		Source(int fd_, Callback callback_)
+		: fd(fd_), callback(std::move(callback_))
+		{ }
+
+		int fd;
+		Callback callback;
+	};
+
+	void drainWakeup();
+
+	std::vector<Source> m_sources;
+	std::vector<int> m_ready;
+
+	TimerWheel m_timers;
+	TimerWheel::Expired m_expired;
+	/// timers cancelled since last wait(), callbacks of the ones that already
+	/// expired are skipped by dispatch()
+	std::vector<TimerID> m_cancelled;
+
+	std::mutex m_posted_mutex;
+	std::vector<Callback> m_posted;
+
+	/// wakeup() writes into the first descriptor, the second one (if it's
+	/// different, i.e. pipe was used instead of eventfd) is watched.
+	int m_wakeup_fds[2];
+
+#ifdef HAVE_SYS_EPOLL_H
+	int m_epoll_fd;
+#endif // HAVE_SYS_EPOLL_H
+};
+
+}
+
+#endif // NCMPCPP_EVENT_LOOP_H
@@ -23,7 +23,6 @@
 #include <cstdio>
 #include <cstdlib>
 #include <iostream>
-#include <sys/select.h>
 #include <unistd.h>
 
 #include "utility/readline.h"
@@ -541,7 +540,7 @@ Window::Window(const Window &rhs)
 , m_title(rhs.m_title)
 , m_color_stack(rhs.m_color_stack)
 , m_input_queue(rhs.m_input_queue)
-, m_fds(rhs.m_fds)
+, m_event_loop(rhs.m_event_loop)
 , m_escape_terminal_sequences(rhs.m_escape_terminal_sequences)
 , m_bold_counter(rhs.m_bold_counter)
 , m_underline_counter(rhs.m_underline_counter)
@@ -566,7 +565,7 @@ Window::Window(Window &&rhs)
 , m_title(std::move(rhs.m_title))
 , m_color_stack(std::move(rhs.m_color_stack))
 , m_input_queue(std::move(rhs.m_input_queue))
-, m_fds(std::move(rhs.m_fds))
+, m_event_loop(std::move(rhs.m_event_loop))
 , m_escape_terminal_sequences(rhs.m_escape_terminal_sequences)
 , m_bold_counter(rhs.m_bold_counter)
 , m_underline_counter(rhs.m_underline_counter)
@@ -592,7 +591,7 @@ Window &Window::operator=(Window rhs)
 	std::swap(m_title, rhs.m_title);
 	std::swap(m_color_stack, rhs.m_color_stack);
 	std::swap(m_input_queue, rhs.m_input_queue);
-	std::swap(m_fds, rhs.m_fds);
+	std::swap(m_event_loop, rhs.m_event_loop);
 	std::swap(m_escape_terminal_sequences, rhs.m_escape_terminal_sequences);
 	std::swap(m_bold_counter, rhs.m_bold_counter);
 	std::swap(m_underline_counter, rhs.m_underline_counter);
@@ -798,19 +797,40 @@ void Window::setTimeout(int timeout)
 	m_window_timeout = timeout;
 }
 
-void Window::addFDCallback(int fd, void (*callback)())
+void Window::addFDCallback(int fd, EventLoop::Callback callback)
 {
-	m_fds.push_back(std::make_pair(fd, callback));
+	eventLoop().addSource(fd, std::move(callback));
+}
+
+void Window::removeFDCallback(int fd)
+{
+	eventLoop().removeSource(fd);
 }
 
 void Window::clearFDCallbacksList()
 {
-	m_fds.clear();
+	if (m_event_loop)
+	{
+		m_event_loop->clearSources();
+		m_event_loop->addSource(STDIN_FILENO, nullptr);
+	}
 }
 
 bool Window::FDCallbacksListEmpty() const
 {
-	return m_fds.empty();
+	// stdin is always there
+	return !m_event_loop || m_event_loop->sources() <= 1;
+}
+
+EventLoop &Window::eventLoop()
+{
+	if (!m_event_loop)
+	{
+		m_event_loop = std::make_shared<EventLoop>();
+		// stdin is handled by readKey itself
+		m_event_loop->addSource(STDIN_FILENO, nullptr);
+	}
+	return *m_event_loop;
 }
 
 Key::Type Window::getInputChar(int key)
@@ -1153,40 +1173,18 @@ Key::Type Window::readKey()
 		return result;
 	}
 	
-	fd_set fds_read;
-	FD_ZERO(&fds_read);
-	FD_SET(STDIN_FILENO, &fds_read);
-	timeval timeout = { m_window_timeout/1000, (m_window_timeout%1000)*1000 };
-	
-	int fd_max = STDIN_FILENO;
-	for (const auto &fd : m_fds)
-	{
-		if (fd.first > fd_max)
-			fd_max = fd.first;
-		FD_SET(fd.first, &fds_read);
-	}
-
-	auto tv_addr = m_window_timeout < 0 ? nullptr : &timeout;
-	int res = select(fd_max+1, &fds_read, nullptr, nullptr, tv_addr);
-	if (res > 0)
+	EventLoop &loop = eventLoop();
+	if (loop.wait(m_window_timeout) && loop.isReady(STDIN_FILENO))
 	{
-		if (FD_ISSET(STDIN_FILENO, &fds_read))
-		{
-			int key = wgetch(m_window);
-			if (key == EOF)
-				result = Key::EoF;
-			else
-				result = getInputChar(key);
-		}
+		int key = wgetch(m_window);
+		if (key == EOF)
+			result = Key::EoF;
 		else
-			result = Key::None;
-
-		for (const auto &fd : m_fds)
-			if (FD_ISSET(fd.first, &fds_read))
-				fd.second();
+			result = getInputChar(key);
 	}
 	else
 		result = Key::None;
+	loop.dispatch();
 	return result;
 }
 
@@ -26,11 +26,13 @@
 #include "config.h"
 
 #include "curses.h"
+#include "curses/event_loop.h"
 #include "gcc.h"
 
 #include <boost/optional.hpp>
 #include <functional>
 #include <list>
+#include <memory>
 #include <stack>
 #include <vector>
 #include <string>
@@ -429,7 +431,10 @@ struct Window
 	/// when there is data waiting for reading in it
 	/// @param fd file descriptor
 	/// @param callback callback
-	void addFDCallback(int fd, void (*callback)());
+	void addFDCallback(int fd, EventLoop::Callback callback);
+	
+	/// Removes given file descriptor from the list of polled ones
+	void removeFDCallback(int fd);
 	
 	/// Clears list of file descriptors and their callbacks
 	void clearFDCallbacksList();
@@ -438,6 +443,10 @@ struct Window
 	/// @return true if list is empty, false otherwise
 	bool FDCallbacksListEmpty() const;
 	
+	/// @return event loop used by readKey() to wait for input. It's shared
+	/// between copies of the window.
+	EventLoop &eventLoop();
+	
 	/// Reads key from standard input (or takes it from input queue)
 	/// and writes it into read_key variable
 	Key::Type readKey();
@@ -554,11 +563,10 @@ private:
 	/// returned by ReadKey
 	std::queue<Key::Type> m_input_queue;
 	
-	/// containter used for additional file descriptors that have
-	/// to be polled in ReadKey() and correspondent callbacks that
-	/// are invoked if there is data available in them
-	typedef std::vector< std::pair<int, void (*)()> > FDCallbacks;
-	FDCallbacks m_fds;
+	/// event loop that polls stdin and additional file descriptors in
+	/// readKey() and invokes correspondent callbacks if there is data
+	/// available in them. Created on first use.
+	std::shared_ptr<EventLoop> m_event_loop;
 	
 	MEVENT m_mouse_event;
 	bool m_escape_terminal_sequences;
@@ -76,6 +76,84 @@ const wchar_t *toColumnName(char c)
 	}
 }
 
+// Geometry of a column, relative to the beginning of the list.
+struct ColumnGeometry
+{
+	ColumnGeometry(const Column &column_, int offset_, int width_, bool separated_)
+	: column(&column_), offset(offset_), width(width_), separated(separated_)
+	{ }
+
+	const Column *column;
+	int offset;
+	int width;
+	// whether the column is followed by a space separating it from the next one
+	bool separated;
+};
+
+typedef std::vector<ColumnGeometry> ColumnLayout;
+
+ColumnLayout computeColumnLayout(int list_width)
+{
+	ColumnLayout result;
+
+	int width;
+	int offset = 0;
+	int remained_width = list_width;
+	std::vector<Column>::const_iterator it, last = Config.columns.end() - 1;
+	for (it = Config.columns.begin(); it != Config.columns.end(); ++it)
+	{
+		// column has relative width and all after it have fixed width,
+		// so stretch it so it fills whole screen along with these after.
+		if (it->stretch_limit >= 0) // (*)
+			width = remained_width - it->stretch_limit;
+		else
+			width = it->fixed ? it->width : it->width * list_width * 0.01;
+		// columns with relative width may shrink to 0, omit them
+		if (width == 0)
+			continue;
+		// if column is not last, we need to have spacing between it
+		// and next column, so we substract it now and restore later.
+		if (it != last)
+			--width;
+
+		// if column doesn't fit into screen, discard it and any other after it.
+		if (remained_width-width < 0 || width < 0 /* this one may come from (*) */)
+			break;
+
+		result.emplace_back(*it, offset, width, it != last);
+		if (it != last)
+		{
+			// add missing width's part and restore the value.
+			remained_width -= width+1;
+			offset += width+1;
+		}
+	}
+
+	return result;
+}
+
+// Column geometry depends only on the available width, which in turn depends
+// on the width of the menu and prefixes/suffixes of the drawn item, so there
+// are only a few distinct layouts at any given time. Cache them so that they
+// are not recomputed for each drawn row.
+const ColumnLayout &columnLayout(int list_width)
+{
+	static std::vector<std::pair<int, ColumnLayout>> cache;
+	static size_t generation = 0;
+	// drop cached layouts if columns were redefined or the terminal was resized
+	// so many times that stale entries accumulated.
+	if (generation != Config.columns_generation || cache.size() > 16)
+	{
+		cache.clear();
+		generation = Config.columns_generation;
+	}
+	for (const auto &entry : cache)
+		if (entry.first == list_width)
+			return entry.second;
+	cache.emplace_back(list_width, computeColumnLayout(list_width));
+	return cache.back().second;
+}
+
 template <typename T>
 void setProperties(NC::Menu<T> &menu, const MPD::Song &s, const SongList &list,
                    bool &separate_albums, bool &is_now_playing, bool &is_selected,
@@ -200,67 +278,44 @@ void showSongsInColumns(NC::Menu<T> &menu, const MPD::Song &s, const SongList &l
 		menu_width -= Config.selected_item_suffix_length;
 	}
 
-	int width;
+	int x = menu.getX();
 	int y = menu.getY();
-	int remained_width = menu_width;
 
-	std::vector<Column>::const_iterator it, last = Config.columns.end() - 1;
-	for (it = Config.columns.begin(); it != Config.columns.end(); ++it)
+	std::wstring tag;
+	for (const auto &geometry : columnLayout(menu_width))
 	{
-		// check current X coordinate
-		int x = menu.getX();
-		// column has relative width and all after it have fixed width,
-		// so stretch it so it fills whole screen along with these after.
-		if (it->stretch_limit >= 0) // (*)
-			width = remained_width - it->stretch_limit;
-		else
-			width = it->fixed ? it->width : it->width * menu_width * 0.01;
-		// columns with relative width may shrink to 0, omit them
-		if (width == 0)
-			continue;
-		// if column is not last, we need to have spacing between it
-		// and next column, so we substract it now and restore later.
-		if (it != last)
-			--width;
-
-		// if column doesn't fit into screen, discard it and any other after it.
-		if (remained_width-width < 0 || width < 0 /* this one may come from (*) */)
-			break;
+		const Column &column = *geometry.column;
+		const int width = geometry.width;
 
-		std::wstring tag;
-		for (size_t i = 0; i < it->type.length(); ++i)
+		tag.clear();
+		for (const auto &get : column.get_functions)
 		{
-			MPD::Song::GetFunction get = charToGetFunction(it->type[i]);
-			assert(get);
-			tag = ToWString(Charset::utf8ToLocale(s.getTags(get)));
+			Charset::utf8ToLocaleWide(tag, s.getTags(get));
 			if (!tag.empty())
 				break;
 		}
-		if (tag.empty() && it->display_empty_tag)
+		if (tag.empty() && column.display_empty_tag)
 			tag = ToWString(Config.empty_tag);
 		wideCut(tag, width);
 
-		if (!discard_colors && it->color != NC::Color::Default)
-			menu << it->color;
+		if (!discard_colors && column.color != NC::Color::Default)
+			menu << column.color;
 
 		int x_off = 0;
 		// if column uses right alignment, calculate proper offset.
 		// otherwise just assume offset is 0, ie. we start from the left.
-		if (it->right_alignment)
+		if (column.right_alignment)
 			x_off = std::max(0, width - int(wideLength(tag)));
 
+		menu.goToXY(x + geometry.offset, y);
 		whline(menu.raw(), NC::Key::Space, width);
-		menu.goToXY(x + x_off, y);
+		menu.goToXY(x + geometry.offset + x_off, y);
 		menu << tag;
-		menu.goToXY(x + width, y);
-		if (it != last)
-		{
-			// add missing width's part and restore the value.
+		menu.goToXY(x + geometry.offset + width, y);
+		if (geometry.separated)
 			menu << ' ';
-			remained_width -= width+1;
-		}
 
-		if (!discard_colors && it->color != NC::Color::Default)
+		if (!discard_colors && column.color != NC::Color::Default)
 			menu << NC::Color::End;
 	}
 
@@ -275,49 +330,31 @@ std::string Display::Columns(size_t list_width)
 	if (Config.columns.empty())
 		return result;
 	
-	int width;
-	int remained_width = list_width;
-	std::vector<Column>::const_iterator it, last = Config.columns.end() - 1;
-	for (it = Config.columns.begin(); it != Config.columns.end(); ++it)
+	for (const auto &geometry : columnLayout(list_width))
 	{
-		// column has relative width and all after it have fixed width,
-		// so stretch it so it fills whole screen along with these after.
-		if (it->stretch_limit >= 0) // (*)
-			width = remained_width - it->stretch_limit;
-		else
-			width = it->fixed ? it->width : it->width * list_width * 0.01;
-		// columns with relative width may shrink to 0, omit them
-		if (width == 0)
-			continue;
-		// if column is not last, we need to have spacing between it
-		// and next column, so we substract it now and restore later.
-		if (it != last)
-			--width;
-		
-		// if column doesn't fit into screen, discard it and any other after it.
-		if (remained_width-width < 0 || width < 0 /* this one may come from (*) */)
-			break;
-		
+		const Column &column = *geometry.column;
+		const int width = geometry.width;
+
 		std::wstring name;
-		if (it->name.empty())
+		if (column.name.empty())
 		{
 			size_t j = 0;
 			while (true)
 			{
-				name += toColumnName(it->type[j]);
+				name += toColumnName(column.type[j]);
 				++j;
-				if (j < it->type.length())
+				if (j < column.type.length())
 					name += '/';
 				else
 					break;
 			}
 		}
 		else
-			name = it->name;
+			name = column.name;
 		wideCut(name, width);
 		
 		int x_off = std::max(0, width - int(wideLength(name)));
-		if (it->right_alignment)
+		if (column.right_alignment)
 		{
 			result += std::string(x_off, NC::Key::Space);
 			result += Charset::utf8ToLocale(ToString(name));
@@ -328,12 +365,8 @@ std::string Display::Columns(size_t list_width)
 			result += std::string(x_off, NC::Key::Space);
 		}
 		
-		if (it != last)
-		{
-			// add missing width's part and restore the value.
-			remained_width -= width+1;
+		if (geometry.separated)
 			result += ' ';
-		}
 	}
 	
 	return result;
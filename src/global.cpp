@@ -29,6 +29,8 @@ BaseScreen *myInactiveScreen;
 NC::Window *wHeader;
 NC::Window *wFooter;
 
+ThreadPool *Workers;
+
 size_t MainStartY;
 size_t MainHeight;
 
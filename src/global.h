@@ -26,6 +26,7 @@
 
 #include "mpdpp.h"
 #include "screens/screen.h"
+#include "utility/thread_pool.h"
 
 namespace Global {
 
@@ -44,6 +45,10 @@ extern NC::Window *wHeader;
 // footer window (below main window)
 extern NC::Window *wFooter;
 
+// pool of threads for background work, completions of its jobs are run by
+// the event loop of footer window
+extern ThreadPool *Workers;
+
 // Y coordinate of top of main window
 extern size_t MainStartY;
 
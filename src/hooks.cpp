@@ -0,0 +1,185 @@
+/***************************************************************************
+ *   Copyright (C) 2008-2021 by Andrzej Rybczak                            *
+ *   andrzej@rybczak.net                                                   *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.              *
+ ***************************************************************************/
+
+#include <algorithm>
+#include <array>
+#include <boost/optional.hpp>
+#include <cerrno>
+#include <chrono>
+#include <csignal>
+#include <cstring>
+#include <spawn.h>
+#include <stdexcept>
+#include <sys/wait.h>
+
+#include "global.h"
+#include "hooks.h"
+#include "settings.h"
+#include "statusbar.h"
+
+extern char **environ;
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+// Time given to terminated commands to exit before they are killed.
+const auto kill_delay = std::chrono::seconds(2);
+
+// How often running commands are checked for completion.
+const auto poll_interval = std::chrono::milliseconds(50);
+
+struct Invocation
+{
+	std::string command;
+	Hooks::Environment env;
+};
+
+struct Hook
+{
+	Hook() : pid(-1), terminated(false) { }
+
+	pid_t pid;
+	Clock::time_point deadline;
+	bool terminated;
+	boost::optional<Invocation> pending;
+};
+
+std::array<Hook, 2> hooks;
+boost::optional<NC::EventLoop::TimerID> poll_timer;
+
+Hook &getHook(Hooks::Type type)
+{
+	switch (type)
+	{
+	case Hooks::Type::SongChange:
+		return hooks[0];
+	case Hooks::Type::PlayerStateChange:
+		return hooks[1];
+	}
+	throw std::logic_error("unreachable");
+}
+
+pid_t spawn(const Invocation &invocation)
+{
+	// Inherited variables are overridden by the ones given explicitly.
+	std::vector<std::string> vars;
+	for (char **var = environ; *var != nullptr; ++var)
+	{
+		const char *eq = strchr(*var, '=');
+		size_t name_len = eq != nullptr ? eq - *var : strlen(*var);
+		bool overridden = std::any_of(
+			invocation.env.begin(), invocation.env.end(), [&](const auto &v) {
+				return v.first.compare(0, std::string::npos, *var, name_len) == 0;
+			});
+		if (!overridden)
+			vars.push_back(*var);
+	}
+	for (const auto &v : invocation.env)
+		vars.push_back(v.first + "=" + v.second);
+	std::vector<char *> envp;
+	for (auto &var : vars)
+		envp.push_back(&var[0]);
+	envp.push_back(nullptr);
+
+	std::string command = invocation.command;
+	char sh[] = "/bin/sh", c[] = "-c";
+	char *argv[] = { sh, c, &command[0], nullptr };
+
+	// Restore SIGPIPE ignored by us. The command stays in our process group,
+	// i.e. in the foreground one, so that it can use the terminal (e.g. query
+	// it for its capabilities) without being stopped by SIGTTIN or SIGTTOU.
+	posix_spawnattr_t attr;
+	posix_spawnattr_init(&attr);
+	posix_spawnattr_setflags(&attr, POSIX_SPAWN_SETSIGDEF);
+	sigset_t default_signals;
+	sigemptyset(&default_signals);
+	sigaddset(&default_signals, SIGPIPE);
+	posix_spawnattr_setsigdefault(&attr, &default_signals);
+
+	pid_t pid;
+	int err = posix_spawn(&pid, sh, nullptr, &attr, argv, envp.data());
+	posix_spawnattr_destroy(&attr);
+	if (err != 0)
+	{
+		Statusbar::printf("Couldn't execute \"%1%\": %2%", invocation.command, strerror(err));
+		return -1;
+	}
+	return pid;
+}
+
+void start(Hook &hook, const Invocation &invocation)
+{
+	hook.pid = spawn(invocation);
+	hook.deadline = Clock::now()
+		+ std::chrono::seconds(Config.execute_on_change_timeout.total_seconds());
+	hook.terminated = false;
+}
+
+void poll()
+{
+	bool running = false;
+	auto now = Clock::now();
+	for (auto &hook : hooks)
+	{
+		if (hook.pid > 0)
+		{
+			int status;
+			pid_t res = waitpid(hook.pid, &status, WNOHANG);
+			if (res == hook.pid || (res < 0 && errno != EINTR))
+				hook.pid = -1;
+			else if (Config.execute_on_change_timeout.total_seconds() > 0
+			         && now >= hook.deadline)
+			{
+				// Ask politely first, then kill. Only the shell is signalled,
+				// as its process group is ours.
+				kill(hook.pid, hook.terminated ? SIGKILL : SIGTERM);
+				hook.terminated = true;
+				hook.deadline = now + kill_delay;
+			}
+		}
+		if (hook.pid < 0 && hook.pending)
+		{
+			start(hook, *hook.pending);
+			hook.pending = boost::none;
+		}
+		running |= hook.pid > 0;
+	}
+	if (!running && poll_timer)
+	{
+		Global::wFooter->eventLoop().cancelTimer(*poll_timer);
+		poll_timer = boost::none;
+	}
+}
+
+}
+
+namespace Hooks {
+
+void run(Type type, const std::string &command, Environment env)
+{
+	auto &hook = getHook(type);
+	hook.pending = Invocation{command, std::move(env)};
+	poll();
+	if (hook.pid > 0 && !poll_timer)
+		poll_timer = Global::wFooter->eventLoop().addPeriodicTimer(poll_interval, poll);
+}
+
+}
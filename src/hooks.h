@@ -0,0 +1,46 @@
+/***************************************************************************
+ *   Copyright (C) 2008-2021 by Andrzej Rybczak                            *
+ *   andrzej@rybczak.net                                                   *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.              *
+ ***************************************************************************/
+
+#ifndef NCMPCPP_HOOKS_H
+#define NCMPCPP_HOOKS_H
+
+#include <string>
+#include <utility>
+#include <vector>
+
+// Commands executed on changes of MPD status (execute_on_song_change and
+// execute_on_player_state_change). They are run in the background with their
+// own environment, so that slow ones don't block the interface.
+namespace Hooks {
+
+enum class Type { SongChange, PlayerStateChange };
+
+typedef std::vector<std::pair<std::string, std::string>> Environment;
+
+// Runs command with additional environment variables. Only one command of each
+// type runs at a time. If one is still running, the new one waits for it to
+// finish, replacing the one that was waiting before (if any), so that e.g.
+// rapidly skipped songs result in a single execution for the last one.
+// Commands running for longer than execute_on_change_timeout are terminated.
+void run(Type type, const std::string &command, Environment env = Environment());
+
+}
+
+#endif // NCMPCPP_HOOKS_H
@@ -22,8 +22,11 @@
 
 #include <boost/algorithm/string/replace.hpp>
 #include <boost/algorithm/string/trim.hpp>
+#include <boost/filesystem/operations.hpp>
 #include <boost/locale/conversion.hpp>
+#include <cstdio>
 #include <fstream>
+#include <iterator>
 #include "charset.h"
 #include "curl_handle.h"
 #include "settings.h"
@@ -35,6 +38,16 @@ namespace {
 const char *apiUrl = "http://ws.audioscrobbler.com/2.0/?api_key=d94e5b6e26469a2d1ffae8ef20131b79&method=";
 const char *msgInvalidResponse = "Invalid response";
 
+std::string cacheDirectory()
+{
+	return Config.ncmpcpp_directory + "lastfm_cache/";
+}
+
+std::string cacheFilename(const std::string &key)
+{
+	return cacheDirectory() + hashString(key);
+}
+
 }
 
 namespace LastFm {
@@ -45,14 +58,7 @@ Service::Result Service::fetch()
 	result.first = false;
 	
 	std::string url = apiUrl;
-	url += methodName();
-	for (auto &arg : m_arguments)
-	{
-		url += "&";
-		url += arg.first;
-		url += "=";
-		url += Curl::escape(arg.second);
-	}
+	url += key();
 
 	std::string data;
 	CURLcode code = Curl::perform(data, url);
@@ -78,6 +84,19 @@ Service::Result Service::fetch()
 	return result;
 }
 
+std::string Service::key()
+{
+	std::string result = methodName();
+	for (auto &arg : m_arguments)
+	{
+		result += "&";
+		result += arg.first;
+		result += "=";
+		result += Curl::escape(arg.second);
+	}
+	return result;
+}
+
 bool Service::actionFailed(const std::string &data)
 {
 	return data.find("status=\"failed\"") != std::string::npos;
@@ -211,4 +230,49 @@ Service::Result ArtistInfo::processData(const std::string &data)
 	return result;
 }
 
+/***********************************************************************/
+
+boost::optional<CachedResult> loadCachedResult(const std::string &key)
+{
+	boost::optional<CachedResult> result;
+	// The first line is the key (hashes may collide), the second one is the
+	// time the result was fetched at and the rest is the result itself.
+	std::ifstream f(cacheFilename(key), std::ios::binary);
+	std::string stored_key, time;
+	if (std::getline(f, stored_key) && stored_key == key && std::getline(f, time))
+	{
+		try
+		{
+			CachedResult cached;
+			cached.time = std::stoll(time);
+			cached.data.assign(std::istreambuf_iterator<char>(f),
+			                   std::istreambuf_iterator<char>());
+			result = std::move(cached);
+		}
+		catch (std::exception &)
+		{
+			// Corrupted file, treat it as missing.
+		}
+	}
+	return result;
+}
+
+void storeCachedResult(const std::string &key, const std::string &data)
+{
+	// Results are stored from worker threads, so write the file under
+	// a temporary name and rename it so that readers never see a partial
+	// one.
+	boost::system::error_code ec;
+	boost::filesystem::create_directories(cacheDirectory(), ec);
+	auto filename = cacheFilename(key);
+	auto tmp_filename = filename + ".tmp";
+	{
+		std::ofstream f(tmp_filename, std::ios::binary);
+		f << key << "\n" << std::time(nullptr) << "\n" << data;
+		if (!f)
+			return;
+	}
+	std::rename(tmp_filename.c_str(), filename.c_str());
+}
+
 }
@@ -23,6 +23,8 @@
 
 #include "config.h"
 
+#include <boost/optional.hpp>
+#include <ctime>
 #include <map>
 #include <string>
 
@@ -39,6 +41,9 @@ struct Service
 
 	virtual const char *name() = 0;
 	virtual Result fetch();
+
+	// Identifies the request made by the service, used as a key in the cache.
+	std::string key();
 	
 	virtual void beautifyOutput(NC::Scrollpad &w) = 0;
 	
@@ -73,6 +78,16 @@ protected:
 	virtual const char *methodName() { return "artist.getinfo"; }
 };
 
+struct CachedResult
+{
+	std::string data;
+	std::time_t time;
+};
+
+// Successful results are cached in ncmpcpp_directory, one file per key.
+boost::optional<CachedResult> loadCachedResult(const std::string &key);
+void storeCachedResult(const std::string &key, const std::string &data);
+
 }
 
 #endif // NCMPCPP_LASTFM_SERVICE_H
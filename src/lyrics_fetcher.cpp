@@ -21,13 +21,13 @@
 #include "config.h"
 #include "curl_handle.h"
 
+#include <algorithm>
+#include <cctype>
 #include <cstdlib>
 #include <cstring>
-#include <boost/algorithm/string/join.hpp>
+#include <istream>
 #include <boost/algorithm/string/replace.hpp>
-#include <boost/algorithm/string/split.hpp>
 #include <boost/algorithm/string/trim.hpp>
-#include <boost/regex.hpp>
 
 #include "charset.h"
 #include "lyrics_fetcher.h"
@@ -70,15 +70,31 @@ const char LyricsFetcher::msgNotFound[] = "Not found";
 LyricsFetcher::Result LyricsFetcher::fetch(const std::string &artist,
                                            const std::string &title)
 {
-	Result result;
-	result.first = false;
-	
+	Step step = start(artist, title);
+	while (auto request = boost::get<Request>(&step))
+	{
+		std::string data;
+		CURLcode code = Curl::perform(data, request->url, request->referer,
+		                              request->follow_redirect);
+		step = proceed(*request, code, data);
+	}
+	return boost::get<Result>(step);
+}
+
+LyricsFetcher::Step LyricsFetcher::start(const std::string &artist,
+                                         const std::string &title)
+{
 	std::string url = urlTemplate();
 	boost::replace_all(url, "%artist%", Curl::escape(artist));
 	boost::replace_all(url, "%title%", Curl::escape(title));
-	
-	std::string data;
-	CURLcode code = Curl::perform(data, url, "", true);
+	return Request(std::move(url), "", true, 0);
+}
+
+LyricsFetcher::Step LyricsFetcher::proceed(const Request &, CURLcode code,
+                                           std::string &data)
+{
+	Result result;
+	result.first = false;
 	
 	if (code != CURLE_OK)
 	{
@@ -86,7 +102,7 @@ LyricsFetcher::Result LyricsFetcher::fetch(const std::string &artist,
 		return result;
 	}
 
-	auto lyrics = getContent(regex(), data);
+	auto lyrics = pattern().extract(data);
 
 	if (lyrics.empty() || notLyrics(data))
 	{
@@ -114,47 +130,44 @@ LyricsFetcher::Result LyricsFetcher::fetch(const std::string &artist,
 	return result;
 }
 
-std::vector<std::string> LyricsFetcher::getContent(const char *regex_,
-                                                   const std::string &data)
-{
-	std::vector<std::string> result;
-	boost::regex rx(regex_);
-	auto first = boost::sregex_iterator(data.begin(), data.end(), rx);
-	auto last = boost::sregex_iterator();
-	for (; first != last; ++first)
-	{
-		std::string content;
-		for (size_t i = 1; i < first->size(); ++i)
-			content += first->str(i);
-		result.push_back(std::move(content));
-	}
-	return result;
-}
-
 void LyricsFetcher::postProcess(std::string &data) const
 {
 	data = unescapeHtmlUtf8(data);
 	stripHtmlTags(data);
-	// Remove indentation from each line and collapse multiple newlines into one.
-	std::vector<std::string> lines;
-	boost::split(lines, data, boost::is_any_of("\n"));
-	for (auto &line : lines)
-		boost::trim(line);
-	std::unique(lines.begin(), lines.end(), [](std::string &a, std::string &b) {
-		return a.empty() && b.empty();
-	});
-	data = boost::algorithm::join(lines, "\n");
+	// Remove indentation from each line and collapse multiple empty lines into
+	// one. Lines are moved to the front in place.
+	size_t out = 0;
+	bool previous_empty = false;
+	for (size_t begin = 0; begin <= data.size();)
+	{
+		size_t end = data.find('\n', begin);
+		if (end == std::string::npos)
+			end = data.size();
+		size_t first = begin, last = end;
+		while (first < last && isspace(static_cast<unsigned char>(data[first])))
+			++first;
+		while (last > first && isspace(static_cast<unsigned char>(data[last-1])))
+			--last;
+		const bool empty = first == last;
+		if (!(empty && previous_empty))
+		{
+			if (begin > 0)
+				data[out++] = '\n';
+			std::char_traits<char>::move(&data[out], &data[first], last - first);
+			out += last - first;
+		}
+		previous_empty = empty;
+		begin = end + 1;
+	}
+	data.resize(out);
 	boost::trim(data);
 }
 
 /**********************************************************************/
 
-LyricsFetcher::Result GoogleLyricsFetcher::fetch(const std::string &artist,
-                                                 const std::string &title)
+LyricsFetcher::Step GoogleLyricsFetcher::start(const std::string &artist,
+                                               const std::string &title)
 {
-	Result result;
-	result.first = false;
-	
 	std::string search_str;
 	if (siteKeyword() != nullptr)
 	{
@@ -172,8 +185,19 @@ LyricsFetcher::Result GoogleLyricsFetcher::fetch(const std::string &artist,
 	google_url += search_str;
 	google_url += "&btnI=I%27m+Feeling+Lucky";
 	
-	std::string data;
-	CURLcode code = Curl::perform(data, google_url, google_url);
+	return Request(google_url, google_url, false, 0);
+}
+
+LyricsFetcher::Step GoogleLyricsFetcher::proceed(const Request &request,
+                                                 CURLcode code,
+                                                 std::string &data)
+{
+	// Second stage is fetching of the page with lyrics.
+	if (request.stage > 0)
+		return LyricsFetcher::proceed(request, code, data);
+
+	Result result;
+	result.first = false;
 	
 	if (code != CURLE_OK)
 	{
@@ -181,18 +205,15 @@ LyricsFetcher::Result GoogleLyricsFetcher::fetch(const std::string &artist,
 		return result;
 	}
 
-	auto urls = getContent("<A HREF=\"http://www.google.com/url\\?q=(.*?)\">here</A>", data);
+	auto url = resultURL(data);
 
-	if (urls.empty() || !isURLOk(urls[0]))
+	if (url.empty() || !isURLOk(url))
 	{
 		result.second = msgNotFound;
 		return result;
 	}
 
-	data = unescapeHtmlUtf8(urls[0]);
-
-	URL = data.c_str();
-	return LyricsFetcher::fetch("", "");
+	return Request(unescapeHtmlUtf8(url), "", true, 1);
 }
 
 bool GoogleLyricsFetcher::isURLOk(const std::string &url)
@@ -200,6 +221,15 @@ bool GoogleLyricsFetcher::isURLOk(const std::string &url)
 	return url.find(siteKeyword()) != std::string::npos;
 }
 
+std::string GoogleLyricsFetcher::resultURL(const std::string &data)
+{
+	auto urls = HtmlPattern()
+		.skipPast("<A HREF=\"http://www.google.com/url?q=")
+		.captureUntil("\">here</A>")
+		.extract(data);
+	return urls.empty() ? "" : urls[0];
+}
+
 /**********************************************************************/
 
 bool MetrolyricsFetcher::isURLOk(const std::string &url)
@@ -210,19 +240,117 @@ bool MetrolyricsFetcher::isURLOk(const std::string &url)
 
 /**********************************************************************/
 
-LyricsFetcher::Result InternetLyricsFetcher::fetch(const std::string &artist,
-                                                   const std::string &title)
+LyricsFetcher::Step InternetLyricsFetcher::proceed(const Request &, CURLcode code,
+                                                   std::string &data)
 {
-	GoogleLyricsFetcher::fetch(artist, title);
 	LyricsFetcher::Result result;
 	result.first = false;
 	result.second = "The following site may contain lyrics for this song: ";
-	result.second += URL;
+	if (code == CURLE_OK)
+		result.second += unescapeHtmlUtf8(resultURL(data));
 	return result;
 }
 
-bool InternetLyricsFetcher::isURLOk(const std::string &url)
+/**********************************************************************/
+
+boost::optional<LyricsFetcher::Result> fetchLyricsInParallel(
+	const LyricsFetchers &fetchers,
+	const std::string &artist,
+	const std::string &title,
+	const std::function<void(const LyricsFetcher &, const std::string &)> &on_failure,
+	const std::function<bool()> &stopped)
 {
-	URL = url;
-	return false;
+	struct Transfer
+	{
+		Transfer(LyricsFetcher &fetcher_)
+		: fetcher(fetcher_), handle(nullptr), step(LyricsFetcher::Result()) { }
+
+		LyricsFetcher &fetcher;
+		CURL *handle;
+		std::string data;
+		LyricsFetcher::Step step;
+	};
+
+	std::vector<Transfer> transfers;
+	transfers.reserve(fetchers.size());
+	for (auto &fetcher : fetchers)
+		transfers.emplace_back(*fetcher);
+
+	CURLM *multi = curl_multi_init();
+	auto remove_handle = [multi](Transfer &t) {
+		if (t.handle != nullptr)
+		{
+			curl_multi_remove_handle(multi, t.handle);
+			Curl::releaseHandle(t.handle);
+			t.handle = nullptr;
+		}
+	};
+	// Starts the transfer of the current step if it's a request, otherwise
+	// reports a failure.
+	auto advance = [&](Transfer &t) {
+		if (auto request = boost::get<LyricsFetcher::Request>(&t.step))
+		{
+			t.data.clear();
+			t.handle = Curl::createHandle(t.data, request->url, request->referer,
+			                              request->follow_redirect);
+			curl_easy_setopt(t.handle, CURLOPT_PRIVATE, &t);
+			curl_multi_add_handle(multi, t.handle);
+		}
+		else
+		{
+			auto &result = boost::get<LyricsFetcher::Result>(t.step);
+			if (!result.first)
+				on_failure(t.fetcher, result.second);
+		}
+	};
+
+	for (auto &t : transfers)
+	{
+		t.step = t.fetcher.start(artist, title);
+		advance(t);
+	}
+
+	boost::optional<LyricsFetcher::Result> result;
+	while (!stopped())
+	{
+		// Result of the fetcher with the highest priority that didn't fail is
+		// final as soon as it's known.
+		auto first = std::find_if(transfers.begin(), transfers.end(), [](auto &t) {
+			auto r = boost::get<LyricsFetcher::Result>(&t.step);
+			return r == nullptr || r->first;
+		});
+		if (first == transfers.end())
+		{
+			result = boost::get<LyricsFetcher::Result>(transfers.back().step);
+			break;
+		}
+		else if (auto r = boost::get<LyricsFetcher::Result>(&first->step))
+		{
+			result = std::move(*r);
+			break;
+		}
+
+		int running, msgs_left;
+		curl_multi_perform(multi, &running);
+		while (CURLMsg *msg = curl_multi_info_read(multi, &msgs_left))
+		{
+			if (msg->msg != CURLMSG_DONE)
+				continue;
+			Transfer *t;
+			curl_easy_getinfo(msg->easy_handle, CURLINFO_PRIVATE, &t);
+			CURLcode code = msg->data.result;
+			remove_handle(*t);
+			t->step = t->fetcher.proceed(
+				boost::get<LyricsFetcher::Request>(t->step), code, t->data);
+			advance(*t);
+		}
+		// Wake up periodically to check whether fetching was stopped.
+		curl_multi_wait(multi, nullptr, 0, 100, nullptr);
+	}
+
+	// Cancel transfers that are still in progress.
+	for (auto &t : transfers)
+		remove_handle(t);
+	curl_multi_cleanup(multi);
+	return result;
 }
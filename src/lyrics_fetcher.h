@@ -23,27 +23,51 @@
 
 #include "config.h"
 
+#include <functional>
 #include <memory>
 #include <string>
+#include <boost/optional.hpp>
+#include <boost/variant.hpp>
+#include "curl/curl.h"
+#include "utility/html.h"
 
 struct LyricsFetcher
 {
 	typedef std::pair<bool, std::string> Result;
 
+	// HTTP request that needs to be performed for fetching to proceed.
+	struct Request
+	{
+		Request(std::string url_, std::string referer_, bool follow_redirect_, int stage_)
+		: url(std::move(url_)), referer(std::move(referer_))
+		, follow_redirect(follow_redirect_), stage(stage_) { }
+
+		std::string url;
+		std::string referer;
+		bool follow_redirect;
+		int stage;
+	};
+
+	// Fetching is a sequence of steps, each one is either a request to perform
+	// or the final result. This allows transfers of multiple fetchers to be
+	// performed at once.
+	typedef boost::variant<Request, Result> Step;
+
 	virtual ~LyricsFetcher() { }
 
 	virtual const char *name() const = 0;
-	virtual Result fetch(const std::string &artist, const std::string &title);
+	Result fetch(const std::string &artist, const std::string &title);
+
+	virtual Step start(const std::string &artist, const std::string &title);
+	virtual Step proceed(const Request &request, CURLcode code, std::string &data);
 	
 protected:
 	virtual const char *urlTemplate() const = 0;
-	virtual const char *regex() const = 0;
+	virtual HtmlPattern pattern() const = 0;
 	
 	virtual bool notLyrics(const std::string &) const { return false; }
 	virtual void postProcess(std::string &data) const;
 	
-	std::vector<std::string> getContent(const char *regex, const std::string &data);
-	
 	static const char msgNotFound[];
 };
 
@@ -57,16 +81,17 @@ std::istream &operator>>(std::istream &is, LyricsFetcher_ &fetcher);
 
 struct GoogleLyricsFetcher : public LyricsFetcher
 {
-	virtual Result fetch(const std::string &artist, const std::string &title);
+	virtual Step start(const std::string &artist, const std::string &title) override;
+	virtual Step proceed(const Request &request, CURLcode code, std::string &data) override;
 	
 protected:
-	virtual const char *urlTemplate() const { return URL; }
+	// URL of the page with lyrics is found by searching.
+	virtual const char *urlTemplate() const override { return nullptr; }
 	virtual const char *siteKeyword() const { return name(); }
 	
 	virtual bool isURLOk(const std::string &url);
-	
-private:
-	const char *URL;
+
+	std::string resultURL(const std::string &data);
 };
 
 struct MusixmatchFetcher : public GoogleLyricsFetcher
@@ -74,7 +99,7 @@ struct MusixmatchFetcher : public GoogleLyricsFetcher
 	virtual const char *name() const override { return "musixmatch.com"; }
 
 protected:
-	virtual const char *regex() const override { return "<span class=\"lyrics__content__.*?>(.*?)</span>"; }
+	virtual HtmlPattern pattern() const override { return HtmlPattern().skipPastElementByPrefix("span", {"lyrics__content__"}).captureUntil("</span>"); }
 
 	virtual void postProcess(std::string &) const override { }
 };
@@ -84,7 +109,7 @@ struct MetrolyricsFetcher : public GoogleLyricsFetcher
 	virtual const char *name() const override { return "metrolyrics.com"; }
 	
 protected:
-	virtual const char *regex() const override { return "<div class=\"lyrics-body\">(.*?)<!--WIDGET.*?<!-- Second Section -->(.*?)<!--WIDGET.*?<!-- Third Section -->(.*?)</div>"; }
+	virtual HtmlPattern pattern() const override { return HtmlPattern().skipPastElement("div", "lyrics-body").captureUntil("<!--WIDGET").skipPast("<!-- Second Section -->").captureUntil("<!--WIDGET").skipPast("<!-- Third Section -->").captureUntil("</div>"); }
 	
 	virtual bool isURLOk(const std::string &url) override;
 };
@@ -94,7 +119,7 @@ struct Sing365Fetcher : public GoogleLyricsFetcher
 	virtual const char *name() const override { return "lyrics007.com"; }
 	
 protected:
-	virtual const char *regex() const override { return "<div class=\"lyrics\">(.*?)</div>"; }
+	virtual HtmlPattern pattern() const override { return HtmlPattern().skipPastElement("div", "lyrics").captureUntil("</div>"); }
 };
 
 struct JustSomeLyricsFetcher : public GoogleLyricsFetcher
@@ -102,7 +127,7 @@ struct JustSomeLyricsFetcher : public GoogleLyricsFetcher
 	virtual const char *name() const override { return "justsomelyrics.com"; }
 	
 protected:
-	virtual const char *regex() const override { return "<div class=\"content.*?</div>(.*?)See also"; }
+	virtual HtmlPattern pattern() const override { return HtmlPattern().skipPastElementByPrefix("div", {"content"}).skipPast("</div>").captureUntil("See also"); }
 };
 
 struct AzLyricsFetcher : public GoogleLyricsFetcher
@@ -110,7 +135,7 @@ struct AzLyricsFetcher : public GoogleLyricsFetcher
 	virtual const char *name() const override { return "azlyrics.com"; }
 	
 protected:
-	virtual const char *regex() const override { return "<div class=\"lyricsh\">.*?</h2>.*<div>(.*?)</div>"; }
+	virtual HtmlPattern pattern() const override { return HtmlPattern().skipPastElement("div", "lyricsh").skipPast("</h2>").skipPastLast("<div>").captureUntil("</div>"); }
 };
 
 struct GeniusFetcher : public GoogleLyricsFetcher
@@ -118,7 +143,7 @@ struct GeniusFetcher : public GoogleLyricsFetcher
 	virtual const char *name() const override { return "genius.com"; }
 
 protected:
-	virtual const char *regex() const override { return "<div.*?class=\"(?:lyrics|Lyrics__Container).*?>(.*?)</div>"; }
+	virtual HtmlPattern pattern() const override { return HtmlPattern().skipPastElementByPrefix("div", {"lyrics", "Lyrics__Container"}).captureUntil("</div>"); }
 };
 
 struct JahLyricsFetcher : public GoogleLyricsFetcher
@@ -126,7 +151,7 @@ struct JahLyricsFetcher : public GoogleLyricsFetcher
 	virtual const char *name() const override { return "jah-lyrics.com"; }
 
 protected:
-	virtual const char *regex() const override { return "<div class=\"song-header\">.*?</div>(.*?)<p class=\"disclaimer\">"; }
+	virtual HtmlPattern pattern() const override { return HtmlPattern().skipPastElement("div", "song-header").skipPast("</div>").captureUntil("<p class=\"disclaimer\">"); }
 };
 
 struct PLyricsFetcher : public GoogleLyricsFetcher
@@ -134,7 +159,7 @@ struct PLyricsFetcher : public GoogleLyricsFetcher
 	virtual const char *name() const override { return "plyrics.com"; }
 
 protected:
-	virtual const char *regex() const override { return "<!-- start of lyrics -->(.*?)<!-- end of lyrics -->"; }
+	virtual HtmlPattern pattern() const override { return HtmlPattern().skipPast("<!-- start of lyrics -->").captureUntil("<!-- end of lyrics -->"); }
 };
 
 struct TekstowoFetcher : public GoogleLyricsFetcher
@@ -142,7 +167,7 @@ struct TekstowoFetcher : public GoogleLyricsFetcher
 	virtual const char *name() const override { return "tekstowo.pl"; }
 
 protected:
-	virtual const char *regex() const override { return "<div class=\"song-text\".*?>.*?</h2>(.*?)<a"; }
+	virtual HtmlPattern pattern() const override { return HtmlPattern().skipPastElement("div", "song-text").skipPast("</h2>").captureUntil("<a"); }
 };
 
 struct ZeneszovegFetcher : public GoogleLyricsFetcher
@@ -150,22 +175,30 @@ struct ZeneszovegFetcher : public GoogleLyricsFetcher
 	virtual const char *name() const override { return "zeneszoveg.hu"; }
 
 protected:
-	virtual const char *regex() const override { return "<div class=\"lyrics-plain-text.*?\">(.*?)</div>"; }
+	virtual HtmlPattern pattern() const override { return HtmlPattern().skipPastElementByPrefix("div", {"lyrics-plain-text"}).captureUntil("</div>"); }
 };
 
 struct InternetLyricsFetcher : public GoogleLyricsFetcher
 {
 	virtual const char *name() const override { return "the Internet"; }
-	virtual Result fetch(const std::string &artist, const std::string &title) override;
+	virtual Step proceed(const Request &request, CURLcode code, std::string &data) override;
 	
 protected:
 	virtual const char *siteKeyword() const override { return nullptr; }
-	virtual const char *regex() const override { return ""; }
-	
-	virtual bool isURLOk(const std::string &url) override;
-	
-private:
-	std::string URL;
+	virtual HtmlPattern pattern() const override { return HtmlPattern(); }
 };
 
+/**********************************************************************/
+
+// Runs all fetchers at once and returns the result of the first one in the
+// order of priority that succeeded. Transfers that are no longer needed are
+// cancelled. Failures are reported in the order in which they occur. Returns
+// none if fetching was stopped.
+boost::optional<LyricsFetcher::Result> fetchLyricsInParallel(
+	const LyricsFetchers &fetchers,
+	const std::string &artist,
+	const std::string &title,
+	const std::function<void(const LyricsFetcher &, const std::string &)> &on_failure,
+	const std::function<bool()> &stopped);
+
 #endif // NCMPCPP_LYRICS_FETCHER_H
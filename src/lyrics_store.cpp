@@ -0,0 +1,439 @@
+/***************************************************************************
+ *   Copyright (C) 2008-2021 by Andrzej Rybczak                            *
+ *   andrzej@rybczak.net                                                   *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.              *
+ ***************************************************************************/
+
+#include "config.h"
+
+#include <algorithm>
+#include <boost/filesystem/operations.hpp>
+#include <cassert>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <sys/file.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+
+#ifdef HAVE_ZLIB_H
+# include <zlib.h>
+#endif // HAVE_ZLIB_H
+
+#include "lyrics_store.h"
+
+namespace {
+
+// Both files start with a magic string, then follow records of the form
+// (all integers are little endian):
+//
+// data:  key size (u32), data size (u32), raw size (u32), flags (u32), key, data
+// index: key size (u32), data size (u32), raw size (u32), flags (u32),
+//        offset of the record in the data file (u64), key
+const char data_magic[] = "NCLYRDB1";
+const char index_magic[] = "NCLYRIX1";
+const size_t magic_size = sizeof(data_magic) - 1;
+const size_t record_header_size = 16;
+const size_t index_entry_header_size = 24;
+
+const uint32_t flag_compressed = 1;
+const uint32_t flag_removed = 2;
+
+void putU32(std::string &out, uint32_t v)
+{
+	for (size_t i = 0; i < 4; ++i)
+		out += char((v >> (8*i)) & 0xff);
+}
+
+void putU64(std::string &out, uint64_t v)
+{
+	for (size_t i = 0; i < 8; ++i)
+		out += char((v >> (8*i)) & 0xff);
+}
+
+uint32_t getU32(const char *p)
+{
+	uint32_t v = 0;
+	for (size_t i = 0; i < 4; ++i)
+		v |= uint32_t(uint8_t(p[i])) << (8*i);
+	return v;
+}
+
+uint64_t getU64(const char *p)
+{
+	uint64_t v = 0;
+	for (size_t i = 0; i < 8; ++i)
+		v |= uint64_t(uint8_t(p[i])) << (8*i);
+	return v;
+}
+
+// Returns false on error or if the file ends before n bytes are read.
+bool readAt(int fd, char *buf, size_t n, uint64_t offset)
+{
+	while (n > 0)
+	{
+		ssize_t r = pread(fd, buf, n, offset);
+		if (r < 0 && errno == EINTR)
+			continue;
+		if (r <= 0)
+			return false;
+		buf += r;
+		n -= r;
+		offset += r;
+	}
+	return true;
+}
+
+bool writeAll(int fd, const std::string &data)
+{
+	const char *buf = data.data();
+	size_t n = data.size();
+	while (n > 0)
+	{
+		ssize_t r = write(fd, buf, n);
+		if (r < 0 && errno == EINTR)
+			continue;
+		if (r < 0)
+			return false;
+		buf += r;
+		n -= r;
+	}
+	return true;
+}
+
+uint64_t fileSize(int fd)
+{
+	struct stat st;
+	if (fstat(fd, &st) < 0)
+		return 0;
+	return st.st_size;
+}
+
+struct FileLock
+{
+	FileLock(int fd, int operation)
+	: m_fd(fd)
+	{
+		while (flock(m_fd, operation) < 0 && errno == EINTR) { }
+	}
+
+	~FileLock()
+	{
+		flock(m_fd, LOCK_UN);
+	}
+
+private:
+	int m_fd;
+};
+
+int openFile(const std::string &path, const char magic[])
+{
+	int fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+	if (fd < 0)
+		throw std::runtime_error("couldn't open " + path + ": " + strerror(errno));
+	FileLock lock(fd, LOCK_EX);
+	char buf[magic_size];
+	if (fileSize(fd) == 0)
+	{
+		if (!writeAll(fd, std::string(magic, magic_size)))
+		{
+			close(fd);
+			throw std::runtime_error("couldn't write to " + path + ": " + strerror(errno));
+		}
+	}
+	else if (!readAt(fd, buf, magic_size, 0) || memcmp(buf, magic, magic_size) != 0)
+	{
+		close(fd);
+		throw std::runtime_error(path + " is not a lyrics store");
+	}
+	return fd;
+}
+
+}
+
+LyricsStore LyricsDB;
+
+LyricsStore::LyricsStore()
+: m_data_fd(-1), m_index_fd(-1), m_scanned(magic_size)
+{ }
+
+LyricsStore::~LyricsStore()
+{
+	if (m_data_fd >= 0)
+		close(m_data_fd);
+	if (m_index_fd >= 0)
+		close(m_index_fd);
+}
+
+void LyricsStore::open(const std::string &directory)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	assert(!isOpen());
+	m_data_path = directory + "/lyrics.db";
+	m_data_fd = openFile(m_data_path, data_magic);
+	try
+	{
+		m_index_fd = openFile(directory + "/lyrics.idx", index_magic);
+	}
+	catch (...)
+	{
+		close(m_data_fd);
+		m_data_fd = -1;
+		throw;
+	}
+	FileLock data_lock(m_data_fd, LOCK_EX);
+	readIndex();
+	scan();
+	// No other instance is appending at this point, so whatever follows the
+	// last complete record was left by an interrupted append and needs to go
+	// away, otherwise new records would end up after it.
+	if (fileSize(m_data_fd) > m_scanned && ftruncate(m_data_fd, m_scanned) < 0) { }
+}
+
+bool LyricsStore::contains(const std::string &key)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return find(key) != nullptr;
+}
+
+boost::optional<std::string> LyricsStore::load(const std::string &key)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	boost::optional<std::string> result;
+	auto entry = find(key);
+	if (entry == nullptr)
+		return result;
+
+	std::string data(entry->size, '\0');
+	const uint64_t data_offset = entry->offset + record_header_size + key.size();
+	if (!readAt(m_data_fd, &data[0], data.size(), data_offset))
+		return result;
+	if (entry->flags & flag_compressed)
+	{
+#		ifdef HAVE_ZLIB_H
+		std::string raw(entry->raw_size, '\0');
+		uLongf raw_size = raw.size();
+		if (uncompress(reinterpret_cast<Bytef *>(&raw[0]), &raw_size,
+		               reinterpret_cast<const Bytef *>(data.data()), data.size()) != Z_OK)
+			return result;
+		raw.resize(raw_size);
+		result = std::move(raw);
+#		endif // HAVE_ZLIB_H
+	}
+	else
+		result = std::move(data);
+	return result;
+}
+
+bool LyricsStore::save(const std::string &key, const std::string &lyrics)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+#	ifdef HAVE_ZLIB_H
+	std::string data(compressBound(lyrics.size()), '\0');
+	uLongf size = data.size();
+	if (compress2(reinterpret_cast<Bytef *>(&data[0]), &size,
+	              reinterpret_cast<const Bytef *>(lyrics.data()), lyrics.size(),
+	              Z_BEST_COMPRESSION) == Z_OK
+	    && size < lyrics.size())
+	{
+		data.resize(size);
+		return append(key, data, lyrics.size(), flag_compressed);
+	}
+#	endif // HAVE_ZLIB_H
+	return append(key, lyrics, lyrics.size(), 0);
+}
+
+bool LyricsStore::remove(const std::string &key)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	if (find(key) == nullptr)
+		return true;
+	return append(key, "", 0, flag_removed);
+}
+
+size_t LyricsStore::importFiles(const std::string &directory)
+{
+	namespace fs = boost::filesystem;
+	size_t result = 0;
+	for (fs::directory_iterator it(directory), end; it != end; ++it)
+	{
+		if (!fs::is_regular_file(it->status()) || it->path().extension() != ".txt")
+			continue;
+		std::ifstream input(it->path().native(), std::ios::binary);
+		if (!input.is_open())
+			throw std::runtime_error("couldn't open " + it->path().native());
+		std::string lyrics((std::istreambuf_iterator<char>(input)),
+		                   std::istreambuf_iterator<char>());
+		if (!save(it->path().stem().native(), lyrics))
+			throw std::runtime_error("couldn't write to " + m_data_path + ": " + strerror(errno));
+		++result;
+	}
+	return result;
+}
+
+size_t LyricsStore::exportFiles(const std::string &directory)
+{
+	std::vector<std::string> keys;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		scan();
+		for (const auto &entry : m_index)
+			keys.push_back(entry.first);
+	}
+	size_t result = 0;
+	for (const auto &key : keys)
+	{
+		auto lyrics = load(key);
+		if (!lyrics)
+			throw std::runtime_error("couldn't read lyrics \"" + key + "\" from " + m_data_path);
+		std::string filename = directory + "/" + key + ".txt";
+		std::ofstream output(filename, std::ios::binary);
+		if (!output.is_open() || !(output << *lyrics))
+			throw std::runtime_error("couldn't write to " + filename);
+		++result;
+	}
+	return result;
+}
+
+const LyricsStore::Entry *LyricsStore::find(const std::string &key)
+{
+	auto it = m_index.find(key);
+	if (it == m_index.end())
+	{
+		// Lyrics might have been added by another instance.
+		scan();
+		it = m_index.find(key);
+		if (it == m_index.end())
+			return nullptr;
+	}
+	return &it->second;
+}
+
+bool LyricsStore::append(const std::string &key, const std::string &data,
+                         uint32_t raw_size, uint32_t flags)
+{
+	std::string record;
+	record.reserve(record_header_size + key.size() + data.size());
+	putU32(record, key.size());
+	putU32(record, data.size());
+	putU32(record, raw_size);
+	putU32(record, flags);
+	record += key;
+	record += data;
+
+	FileLock lock(m_data_fd, LOCK_EX);
+	Entry entry;
+	entry.offset = fileSize(m_data_fd);
+	entry.size = data.size();
+	entry.raw_size = raw_size;
+	entry.flags = flags;
+	if (!writeAll(m_data_fd, record))
+	{
+		// Discard the partially written record.
+		int err = errno;
+		if (ftruncate(m_data_fd, entry.offset) < 0) { }
+		errno = err;
+		return false;
+	}
+
+	std::string index_entry;
+	putU32(index_entry, key.size());
+	putU32(index_entry, entry.size);
+	putU32(index_entry, entry.raw_size);
+	putU32(index_entry, entry.flags);
+	putU64(index_entry, entry.offset);
+	index_entry += key;
+	// Failure is not fatal, missing records are found by scanning.
+	writeAll(m_index_fd, index_entry);
+
+	if (m_scanned == entry.offset)
+		m_scanned += record.size();
+	apply(key, entry);
+	return true;
+}
+
+void LyricsStore::apply(std::string key, const Entry &entry)
+{
+	if (entry.flags & flag_removed)
+		m_index.erase(key);
+	else
+		m_index[std::move(key)] = entry;
+}
+
+void LyricsStore::readIndex()
+{
+	const uint64_t data_size = fileSize(m_data_fd);
+	std::string index(fileSize(m_index_fd), '\0');
+	if (!readAt(m_index_fd, &index[0], index.size(), 0))
+		return;
+
+	size_t pos = magic_size;
+	while (index.size() - pos >= index_entry_header_size)
+	{
+		const char *p = index.data() + pos;
+		const uint32_t key_size = getU32(p);
+		if (index.size() - pos - index_entry_header_size < key_size)
+			break;
+		Entry entry;
+		entry.size = getU32(p + 4);
+		entry.raw_size = getU32(p + 8);
+		entry.flags = getU32(p + 12);
+		entry.offset = getU64(p + 16);
+		const uint64_t end = entry.offset + record_header_size + key_size + entry.size;
+		// The entry is garbage, e.g. it was only partially written and later
+		// ones follow it. Records past it are found by scanning.
+		if (entry.offset < magic_size || end < entry.offset || end > data_size)
+			break;
+		apply(std::string(p + index_entry_header_size, key_size), entry);
+		m_scanned = std::max(m_scanned, end);
+		pos += index_entry_header_size + key_size;
+	}
+	// Get rid of entries that were only partially written so that new ones
+	// can be appended after the last complete one.
+	if (pos != index.size() && ftruncate(m_index_fd, pos) < 0) { }
+}
+
+void LyricsStore::scan()
+{
+	char header[record_header_size];
+	std::string key;
+	const uint64_t size = fileSize(m_data_fd);
+	while (m_scanned + record_header_size <= size
+	       && readAt(m_data_fd, header, record_header_size, m_scanned))
+	{
+		const uint32_t key_size = getU32(header);
+		Entry entry;
+		entry.offset = m_scanned;
+		entry.size = getU32(header + 4);
+		entry.raw_size = getU32(header + 8);
+		entry.flags = getU32(header + 12);
+		const uint64_t next = m_scanned + record_header_size + key_size + entry.size;
+		// The record is still being written (or was torn, in which case sizes
+		// are garbage), check them before reading the key.
+		if (next > size)
+			break;
+		key.resize(key_size);
+		if (!readAt(m_data_fd, &key[0], key_size, m_scanned + record_header_size))
+			break;
+		apply(key, entry);
+		m_scanned = next;
+	}
+}
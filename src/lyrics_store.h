@@ -0,0 +1,93 @@
+/***************************************************************************
+ *   Copyright (C) 2008-2021 by Andrzej Rybczak                            *
+ *   andrzej@rybczak.net                                                   *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.              *
+ ***************************************************************************/
+
+#ifndef NCMPCPP_LYRICS_STORE_H
+#define NCMPCPP_LYRICS_STORE_H
+
+#include "config.h"
+
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <boost/optional.hpp>
+
+// Lyrics of all songs kept in a single append-only data file along with an
+// append-only index of its records, which is loaded into a hash table keyed
+// by names of lyrics (the same as names of files in lyrics_directory without
+// the extension). Records are compressed if zlib is available. Store can be
+// shared by multiple instances of ncmpcpp, appends are serialized with flock.
+struct LyricsStore
+{
+	LyricsStore();
+	~LyricsStore();
+
+	LyricsStore(const LyricsStore &) = delete;
+	LyricsStore &operator=(const LyricsStore &) = delete;
+
+	// Throws std::runtime_error if the store couldn't be opened.
+	void open(const std::string &directory);
+	bool isOpen() const { return m_data_fd >= 0; }
+	const std::string &path() const { return m_data_path; }
+
+	bool contains(const std::string &key);
+	boost::optional<std::string> load(const std::string &key);
+
+	// Return false and set errno on failure.
+	bool save(const std::string &key, const std::string &lyrics);
+	bool remove(const std::string &key);
+
+	// Copy lyrics from and to files in the directory, named after their keys
+	// with the .txt extension. Return the amount of copied lyrics and throw
+	// std::runtime_error on failure.
+	size_t importFiles(const std::string &directory);
+	size_t exportFiles(const std::string &directory);
+
+private:
+	struct Entry
+	{
+		uint64_t offset;
+		uint32_t size;
+		uint32_t raw_size;
+		uint32_t flags;
+	};
+
+	const Entry *find(const std::string &key);
+	bool append(const std::string &key, const std::string &data,
+	            uint32_t raw_size, uint32_t flags);
+	void apply(std::string key, const Entry &entry);
+
+	void readIndex();
+	void scan();
+
+	int m_data_fd;
+	int m_index_fd;
+	std::string m_data_path;
+
+	// Offset in the data file up to which records are indexed.
+	uint64_t m_scanned;
+	std::unordered_map<std::string, Entry> m_index;
+
+	std::mutex m_mutex;
+};
+
+extern LyricsStore LyricsDB;
+
+#endif // NCMPCPP_LYRICS_STORE_H
@@ -18,6 +18,7 @@
  *   51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.              *
  ***************************************************************************/
 
+#include <algorithm>
 #include <cerrno>
 #include <clocale>
 #include <csignal>
@@ -28,6 +29,7 @@
 #include <iostream>
 #include <fstream>
 #include <stdexcept>
+#include <thread>
 
 #include "mpdpp.h"
 
@@ -129,6 +131,15 @@ int main(int argc, char **argv)
 	
 	wFooter = new NC::Window(0, Actions::FooterStartY, COLS, Actions::FooterHeight, "", Config.statusbar_color, NC::Border());
 	wFooter->setPromptHook(Statusbar::Helpers::mainHook);
+
+	// Jobs are mostly waiting for network, but they also parse what they got,
+	// so don't run more of them than there are cores (but at least two, so that
+	// a slow download doesn't hold everything else up).
+	Global::Workers = new ThreadPool(
+		std::max(std::thread::hardware_concurrency(), 2u),
+		[&loop = wFooter->eventLoop()](ThreadPool::Job job) {
+			loop.post(std::move(job));
+		});
 	
 	// initialize global timer
 	Timer = boost::posix_time::microsec_clock::local_time();
@@ -23,6 +23,7 @@
 #include <boost/filesystem.hpp>
 #include <boost/locale/conversion.hpp>
 #include <time.h>
+#include <unordered_map>
 
 #include "screens/browser.h"
 #include "charset.h"
@@ -63,7 +64,7 @@ bool isItemParentDirectory(const MPD::Item &item);
 bool isRootDirectory(const std::string &directory);
 bool isHidden(const fs::directory_iterator &entry);
 bool hasSupportedExtension(const fs::directory_entry &entry);
-MPD::Song getLocalSong(const fs::directory_entry &entry, bool read_tags);
+MPD::Song getLocalSong(const fs::directory_entry &entry, bool read_mtime, bool read_tags);
 void getLocalDirectory(NC::Menu<MPD::Item> &menu, const std::string &directory);
 void getLocalDirectoryRecursively(std::vector<MPD::Song> &songs,
                                   const std::string &directory);
@@ -134,6 +135,9 @@ Browser::Browser()
 , m_local_browser(false)
 , m_scroll_beginning(0)
 , m_current_directory("/")
+#ifdef HAVE_TAGLIB_H
+, m_tags_jobs(0)
+#endif // HAVE_TAGLIB_H
 {
 	w = NC::Menu<MPD::Item>(0, MainStartY, COLS, MainHeight, Config.browser_display_mode == DisplayMode::Columns && Config.titles_visibility ? Display::Columns(COLS) : "", Config.main_color, NC::Border());
 	setHighlightFixes(w);
@@ -466,6 +470,14 @@ bool Browser::enterDirectory()
 
 void Browser::getDirectory(std::string directory)
 {
+#ifdef HAVE_TAGLIB_H
+	// Tags of songs in the previous listing are no longer needed.
+	m_tags_reader.cancel();
+	m_tags_reader = ThreadPool::CancellationToken();
+	m_unread_songs.clear();
+	m_tags_jobs = 0;
+#endif // HAVE_TAGLIB_H
+
 	{
 		ScopedUnfilteredMenu<MPD::Item> sunfilter(ReapplyFilter::Yes, w);
 
@@ -521,6 +533,15 @@ void Browser::getDirectory(std::string directory)
 				LocaleBasedItemSorting(std::locale(), Config.ignore_leading_the,
 				                       Config.browser_sort_mode));
 		}
+
+#ifdef HAVE_TAGLIB_H
+		if (m_local_browser)
+		{
+			for (const auto &item : w)
+				if (item.value().type() == MPD::Item::Type::Song)
+					m_unread_songs.insert(item.value().song().getURI());
+		}
+#endif // HAVE_TAGLIB_H
 	}
 
 	for (size_t i = 0; i < w.size(); ++i)
@@ -533,6 +554,10 @@ void Browser::getDirectory(std::string directory)
 		}
 	}
 	m_current_directory = directory;
+
+#ifdef HAVE_TAGLIB_H
+	readLocalTags();
+#endif // HAVE_TAGLIB_H
 }
 
 void Browser::changeBrowseMode()
@@ -595,6 +620,129 @@ void Browser::remove(const MPD::Item &item)
 	}
 }
 
+#ifdef HAVE_TAGLIB_H
+void Browser::readLocalTags()
+{
+	// Tags are read in batches so that rows are updated often, but the main
+	// loop is not woken up for every single song.
+	const size_t batch_size = 8;
+	// Don't queue more batches than can run at once, so that the ones read
+	// later are picked around the item highlighted at that time.
+	const size_t max_jobs = Global::Workers->maxLowPriorityJobs();
+
+	while (m_tags_jobs < max_jobs && !m_unread_songs.empty())
+	{
+		std::vector<std::string> batch;
+		auto take = [this, &batch](size_t i) {
+			const auto &item = w[i].value();
+			if (item.type() != MPD::Item::Type::Song)
+				return;
+			auto it = m_unread_songs.find(item.song().getURI());
+			if (it != m_unread_songs.end())
+			{
+				batch.push_back(*it);
+				m_unread_songs.erase(it);
+			}
+		};
+		// Songs around the highlighted one are visible, so they go first. Then
+		// the rest (including ones hidden by the filter) in any order.
+		size_t choice = w.empty() ? 0 : w.choice();
+		size_t distance = std::min(w.size(), size_t(w.getHeight()));
+		for (size_t d = 0; d <= distance && batch.size() < batch_size; ++d)
+		{
+			if (choice+d < w.size())
+				take(choice+d);
+			if (d > 0 && d <= choice)
+				take(choice-d);
+		}
+		while (batch.size() < batch_size && !m_unread_songs.empty())
+		{
+			batch.push_back(*m_unread_songs.begin());
+			m_unread_songs.erase(m_unread_songs.begin());
+		}
+
+		++m_tags_jobs;
+		Global::Workers->submit(
+			ThreadPool::Priority::Normal, m_tags_reader,
+			[batch = std::move(batch), token = m_tags_reader] {
+				std::vector<MPD::Song> songs;
+				for (const auto &path : batch)
+				{
+					if (token.cancelled())
+						break;
+					try
+					{
+						songs.push_back(getLocalSong(fs::directory_entry(path), true, true));
+					}
+					catch (std::exception &)
+					{
+						// The file was most likely removed in the meantime.
+					}
+				}
+				return songs;
+			},
+			[this](std::vector<MPD::Song> songs) {
+				updateLocalTags(std::move(songs));
+			});
+	}
+}
+
+void Browser::updateLocalTags(std::vector<MPD::Song> songs)
+{
+	--m_tags_jobs;
+	bool finished = m_tags_jobs == 0 && m_unread_songs.empty();
+
+	// Remember the highlighted song as it might be moved by sorting.
+	std::string current_uri;
+	if (!w.empty() && w.current()->value().type() == MPD::Item::Type::Song)
+		current_uri = w.current()->value().song().getURI();
+
+	{
+		// Filtering and sorting by tags is redone when all of them are read.
+		ScopedUnfilteredMenu<MPD::Item> sunfilter(
+			finished ? ReapplyFilter::Yes : ReapplyFilter::No, w);
+
+		std::unordered_map<std::string, MPD::Song *> by_uri;
+		for (auto &s : songs)
+			by_uri[s.getURI()] = &s;
+		for (auto &item : w)
+		{
+			if (item.value().type() != MPD::Item::Type::Song)
+				continue;
+			auto it = by_uri.find(item.value().song().getURI());
+			if (it != by_uri.end())
+				item.value() = std::move(*it->second);
+		}
+
+		if (finished && Config.browser_sort_mode == SortMode::CustomFormat)
+		{
+			std::stable_sort(
+				w.begin() + (inRootDirectory() ? 0 : 1), w.end(),
+				LocaleBasedItemSorting(std::locale(), Config.ignore_leading_the,
+				                       Config.browser_sort_mode));
+		}
+	}
+
+	if (finished && !current_uri.empty())
+	{
+		for (size_t i = 0; i < w.size(); ++i)
+		{
+			if (w[i].value().type() == MPD::Item::Type::Song
+			    && w[i].value().song().getURI() == current_uri)
+			{
+				w.highlight(i);
+				break;
+			}
+		}
+	}
+
+	readLocalTags();
+
+	if (isVisible(this))
+		w.refresh();
+}
+#endif // HAVE_TAGLIB_H
+
 /***********************************************************************/
 
 void Browser::fetchSupportedExtensions()
@@ -643,22 +791,23 @@ bool hasSupportedExtension(const fs::directory_entry &entry)
 	    != lm_supported_extensions.end();
 }
 
-MPD::Song getLocalSong(const fs::directory_entry &entry, bool read_tags)
+MPD::Song getLocalSong(const fs::directory_entry &entry, bool read_mtime, bool read_tags)
 {
 	mpd_pair pair = { "file", entry.path().c_str() };
 	mpd_song *s = mpd_song_begin(&pair);
 	if (s == nullptr)
 		throw std::runtime_error("invalid path: " + entry.path().native());
-	if (read_tags)
-	{
 #ifdef HAVE_TAGLIB_H
+	if (read_mtime)
+	{
 		Tags::setAttribute(s, "Last-Modified",
 			timeFormat("%Y-%m-%dT%H:%M:%SZ", fs::last_write_time(entry.path()))
 		);
-		// read tags
+	}
+	// read tags
+	if (read_tags)
 		Tags::read(s);
 #endif // HAVE_TAGLIB_H
-	}
 	return s;
 }
 
@@ -675,7 +824,10 @@ void getLocalDirectory(NC::Menu<MPD::Item> &menu, const std::string &directory)
 		                            fs::last_write_time(entry->path())));
 	}
 	else if (hasSupportedExtension(*entry))
-		menu.addItem(getLocalSong(*entry, true));
+	{
+		// Tags are read by the browser in the background.
+		menu.addItem(getLocalSong(*entry, true, false));
+	}
 	}
 }
 
@@ -693,7 +845,7 @@ void getLocalDirectoryRecursively(std::vector<MPD::Song> &songs, const std::stri
 			sort_offset = songs.size();
 		}
 		else if (hasSupportedExtension(*entry))
-			songs.push_back(getLocalSong(*entry, false));
+			songs.push_back(getLocalSong(*entry, false, false));
 	};
 
 	if (Config.browser_sort_mode != SortMode::None)
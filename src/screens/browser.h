@@ -21,11 +21,16 @@
 #ifndef NCMPCPP_BROWSER_H
 #define NCMPCPP_BROWSER_H
 
+#include "config.h"
+
+#include <unordered_set>
+
 #include "interfaces.h"
 #include "mpdpp.h"
 #include "regex_filter.h"
 #include "screens/screen.h"
 #include "song_list.h"
+#include "utility/thread_pool.h"
 
 struct BrowserWindow: NC::Menu<MPD::Item>, SongList
 {
@@ -95,12 +100,25 @@ struct Browser: Screen<BrowserWindow>, Filterable, HasSongs, Searchable, Tabbabl
 	static void fetchSupportedExtensions();
 
 private:
+#ifdef HAVE_TAGLIB_H
+	void readLocalTags();
+	void updateLocalTags(std::vector<MPD::Song> songs);
+#endif // HAVE_TAGLIB_H
+
 	bool m_redraw_header;
 	bool m_update_request;
 	bool m_local_browser;
 	size_t m_scroll_beginning;
 	std::string m_current_directory;
 	Regex::Filter<MPD::Item> m_search_predicate;
+
+#ifdef HAVE_TAGLIB_H
+	// Songs in the local browser are shown with their filenames first, their
+	// tags are read in the background.
+	ThreadPool::CancellationToken m_tags_reader;
+	std::unordered_set<std::string> m_unread_songs;
+	size_t m_tags_jobs;
+#endif // HAVE_TAGLIB_H
 };
 
 extern Browser *myBrowser;
@@ -35,6 +35,7 @@ Lastfm *myLastfm;
 Lastfm::Lastfm()
 	: Screen(NC::Scrollpad(0, MainStartY, COLS, MainHeight, "", Config.main_color, NC::Border()))
 	, m_refresh_window(false)
+	, m_refreshing(false)
 { }
 
 void Lastfm::resize()
@@ -56,22 +57,6 @@ std::wstring Lastfm::title()
 
 void Lastfm::update()
 {
-	if (m_worker.valid() && m_worker.is_ready())
-	{
-		auto result = m_worker.get();
-		if (result.first)
-		{
-			w.clear();
-			w << Charset::utf8ToLocale(result.second);
-			m_service->beautifyOutput(w);
-		}
-		else
-			w << " " << NC::Color::Red << result.second << NC::Color::End;
-		// reset m_worker so it's no longer valid
-		m_worker = boost::BOOST_THREAD_FUTURE<LastFm::Service::Result>();
-		m_refresh_window = true;
-	}
-
 	if (m_refresh_window)
 	{
 		m_refresh_window = false;
@@ -80,6 +65,67 @@ void Lastfm::update()
 	}
 }
 
+void Lastfm::startJob()
+{
+	m_title = ToWString(m_service->name());
+	m_refresh_window = true;
+	// Discard the result of the previous job (if any).
+	m_job.cancel();
+
+	auto key = m_service->key();
+	auto ttl = Config.lastfm_cache_ttl.total_seconds();
+	boost::optional<LastFm::CachedResult> cached;
+	if (ttl > 0)
+		cached = LastFm::loadCachedResult(key);
+	if (cached)
+	{
+		showResult(cached->data);
+		if (std::time(nullptr) - cached->time < ttl)
+		{
+			m_refreshing = false;
+			return;
+		}
+	}
+	else
+	{
+		w.clear();
+		w << "Fetching information...";
+	}
+
+	m_refreshing = cached.is_initialized();
+	m_job = ThreadPool::CancellationToken();
+	Global::Workers->submit(
+		m_refreshing ? ThreadPool::Priority::Low : ThreadPool::Priority::High, m_job,
+		[service = m_service, key = std::move(key), ttl] {
+			auto result = service->fetch();
+			if (result.first && ttl > 0)
+				LastFm::storeCachedResult(key, result.second);
+			return result;
+		},
+		[this](LastFm::Service::Result result) {
+			finishJob(result);
+		});
+}
+
+void Lastfm::finishJob(const LastFm::Service::Result &result)
+{
+	if (result.first)
+		showResult(result.second);
+	else if (m_refreshing)
+		Statusbar::printf("Couldn't refresh %1%: %2%", m_service->name(), result.second);
+	else
+		w << " " << NC::Color::Red << result.second << NC::Color::End;
+	m_refreshing = false;
+	m_refresh_window = true;
+}
+
+void Lastfm::showResult(const std::string &data)
+{
+	w.clear();
+	w << Charset::utf8ToLocale(data);
+	m_service->beautifyOutput(w);
+}
+
 void Lastfm::switchTo()
 {
 	using Global::myScreen;
@@ -23,12 +23,12 @@
 
 #include "config.h"
 
-#include <boost/thread/future.hpp>
 #include <memory>
 
 #include "interfaces.h"
 #include "lastfm_service.h"
 #include "screens/screen.h"
+#include "utility/thread_pool.h"
 #include "utility/wide_string.h"
 
 struct Lastfm: Screen<NC::Scrollpad>, Tabbable
@@ -55,22 +55,21 @@ struct Lastfm: Screen<NC::Scrollpad>, Tabbable
 			return;
 
 		m_service = std::shared_ptr<ServiceT>(service);
-		m_worker = boost::async(
-			boost::launch::async,
-			std::bind(&LastFm::Service::fetch, m_service));
-
-		w.clear();
-		w << "Fetching information...";
-		m_refresh_window = true;
-		m_title = ToWString(m_service->name());
+		startJob();
 	}
 
 private:
+	void startJob();
+	void finishJob(const LastFm::Service::Result &result);
+	void showResult(const std::string &data);
+
 	std::wstring m_title;
 	bool m_refresh_window;
+	// Cached result is shown while a fresh one is being fetched.
+	bool m_refreshing;
 	
 	std::shared_ptr<LastFm::Service> m_service;
-	boost::BOOST_THREAD_FUTURE<LastFm::Service::Result> m_worker;
+	ThreadPool::CancellationToken m_job;
 };
 
 extern Lastfm *myLastfm;
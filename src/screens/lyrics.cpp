@@ -24,8 +24,9 @@
 #include <cassert>
 #include <cerrno>
 #include <cstring>
+#include <chrono>
 #include <fstream>
-#include <thread>
+#include <sstream>
 
 #include "curses/scrollpad.h"
 #include "screens/browser.h"
@@ -34,6 +35,7 @@
 #include "format_impl.h"
 #include "global.h"
 #include "helpers.h"
+#include "lyrics_store.h"
 #include "macro_utilities.h"
 #include "screens/lyrics.h"
 #include "screens/playlist.h"
@@ -51,6 +53,9 @@ Lyrics *myLyrics;
 
 namespace {
 
+// Number of most recently prefetched songs that are not prefetched again.
+const size_t max_prefetched_uris = 1000;
+
 std::string removeExtension(std::string filename)
 {
 	size_t dot = filename.rfind('.');
@@ -59,6 +64,26 @@ std::string removeExtension(std::string filename)
 	return filename;
 }
 
+// Lyrics stored in directories of songs are never kept in the single file.
+bool isInLyricsDB(const MPD::Song &s)
+{
+	return LyricsDB.isOpen() && !(Config.store_lyrics_in_song_dir && !s.isStream());
+}
+
+// Name of lyrics in lyrics_directory, without the extension.
+std::string lyricsName(const MPD::Song &s)
+{
+	std::string name;
+	std::string artist = s.getArtist();
+	std::string title  = s.getTitle();
+	if (artist.empty() || title.empty())
+		name = removeExtension(s.getName());
+	else
+		name = artist + " - " + title;
+	removeInvalidCharsFromFilename(name, Config.generate_win32_compatible_filenames);
+	return name;
+}
+
 std::string lyricsFilename(const MPD::Song &s)
 {
 	std::string filename;
@@ -70,36 +95,58 @@ std::string lyricsFilename(const MPD::Song &s)
 		removeExtension(filename);
 	}
 	else
-	{
-		std::string artist = s.getArtist();
-		std::string title  = s.getTitle();
-		if (artist.empty() || title.empty())
-			filename = removeExtension(s.getName());
-		else
-			filename = artist + " - " + title;
-		removeInvalidCharsFromFilename(filename, Config.generate_win32_compatible_filenames);
-		filename = Config.lyrics_directory + "/" + filename;
-	}
+		filename = Config.lyrics_directory + "/" + lyricsName(s);
 	filename += ".txt";
 	return filename;
 }
 
-bool loadLyrics(NC::Scrollpad &w, const std::string &filename)
+// Where lyrics of the song are saved.
+std::string lyricsLocation(const MPD::Song &s)
 {
-	std::ifstream input(filename);
-	if (input.is_open())
+	return isInLyricsDB(s) ? LyricsDB.path() : lyricsFilename(s);
+}
+
+// If the single file is used, only its index is checked, so that songs without
+// lyrics don't cost a filesystem lookup each. Separate files (not imported yet
+// or being edited) are still used by loadLyrics.
+bool lyricsExist(const MPD::Song &s)
+{
+	if (isInLyricsDB(s))
+		return LyricsDB.contains(lyricsName(s));
+	else
+		return boost::filesystem::exists(lyricsFilename(s));
+}
+
+void showLyrics(NC::Scrollpad &w, std::istream &input)
+{
+	std::string line;
+	bool first_line = true;
+	while (std::getline(input, line))
 	{
-		std::string line;
-		bool first_line = true;
-		while (std::getline(input, line))
+		// Remove carriage returns as they mess up the display.
+		boost::remove_erase(line, '\r');
+		if (!first_line)
+			w << '\n';
+		w << Charset::utf8ToLocale(line);
+		first_line = false;
+	}
+}
+
+bool loadLyrics(NC::Scrollpad &w, const MPD::Song &s)
+{
+	if (isInLyricsDB(s))
+	{
+		if (auto lyrics = LyricsDB.load(lyricsName(s)))
 		{
-			// Remove carriage returns as they mess up the display.
-			boost::remove_erase(line, '\r');
-			if (!first_line)
-				w << '\n';
-			w << Charset::utf8ToLocale(line);
-			first_line = false;
+			std::istringstream input(*lyrics);
+			showLyrics(w, input);
+			return true;
 		}
+	}
+	std::ifstream input(lyricsFilename(s));
+	if (input.is_open())
+	{
+		showLyrics(w, input);
 		return true;
 	}
 	else
@@ -119,6 +166,14 @@ bool saveLyrics(const std::string &filename, const std::string &lyrics)
 		return false;
 }
 
+bool saveLyrics(const MPD::Song &s, const std::string &lyrics)
+{
+	if (isInLyricsDB(s))
+		return LyricsDB.save(lyricsName(s), lyrics);
+	else
+		return saveLyrics(lyricsFilename(s), lyrics);
+}
+
 boost::optional<std::string> downloadLyrics(
 	const MPD::Song &s,
 	std::shared_ptr<Shared<NC::Buffer>> shared_buffer,
@@ -167,7 +222,36 @@ boost::optional<std::string> downloadLyrics(
 	};
 
 	LyricsFetcher::Result fetcher_result;
-	if (current_fetcher == nullptr)
+	if (current_fetcher == nullptr && Config.fetch_lyrics_in_parallel)
+	{
+		if (shared_buffer)
+		{
+			auto buf = shared_buffer->acquire();
+			*buf << "Fetching lyrics from all sources...\n";
+		}
+		auto result_ = fetchLyricsInParallel(
+			Config.lyrics_fetchers, s_artist, s_title,
+			[&shared_buffer](const LyricsFetcher &fetcher_, const std::string &error) {
+				if (shared_buffer)
+				{
+					auto buf = shared_buffer->acquire();
+					*buf << NC::Format::Bold
+					     << fetcher_.name()
+					     << NC::Format::NoBold << ": "
+					     << NC::Color::Red
+					     << error
+					     << NC::Color::End
+					     << '\n';
+				}
+			},
+			[&download_stopper] {
+				return download_stopper && download_stopper->load();
+			});
+		if (!result_)
+			return boost::none;
+		fetcher_result = std::move(*result_);
+	}
+	else if (current_fetcher == nullptr)
 	{
 		for (auto &fetcher : Config.lyrics_fetchers)
 		{
@@ -193,6 +277,7 @@ Lyrics::Lyrics()
 	: Screen(NC::Scrollpad(0, MainStartY, COLS, MainHeight, "", Config.main_color, NC::Border()))
 	, m_refresh_window(false)
 	, m_scroll_begin(0)
+	, m_downloading(false)
 	, m_fetcher(nullptr)
 { }
 
@@ -207,7 +292,7 @@ void Lyrics::resize()
 
 void Lyrics::update()
 {
-	if (m_worker.valid())
+	if (m_downloading)
 	{
 		auto buffer = m_shared_buffer->acquire();
 		if (!buffer->empty())
@@ -216,24 +301,6 @@ void Lyrics::update()
 			buffer->clear();
 			m_refresh_window = true;
 		}
-
-		if (m_worker.is_ready())
-		{
-			auto lyrics = m_worker.get();
-			if (lyrics)
-			{
-				w.clear();
-				w << Charset::utf8ToLocale(*lyrics);
-				std::string filename = lyricsFilename(m_song);
-				if (!saveLyrics(filename, *lyrics))
-					Statusbar::printf("Couldn't save lyrics as \"%1%\": %2%",
-					                  filename, strerror(errno));
-			}
-			else
-				w << "\nLyrics were not found.\n";
-			clearWorker();
-			m_refresh_window = true;
-		}
 	}
 
 	if (m_refresh_window)
@@ -275,33 +342,61 @@ std::wstring Lyrics::title()
 
 void Lyrics::fetch(const MPD::Song &s)
 {
-	if (!m_worker.valid() || s != m_song)
+	if (!m_downloading || s != m_song)
 	{
 		stopDownload();
 		w.clear();
 		w.reset();
 		m_song = s;
-		if (loadLyrics(w, lyricsFilename(m_song)))
+		if (loadLyrics(w, m_song))
 		{
 			clearWorker();
 			m_refresh_window = true;
 		}
 		else
 		{
-			m_download_stopper = std::make_shared<std::atomic<bool>>(false);
+			m_download = ThreadPool::CancellationToken();
 			m_shared_buffer = std::make_shared<Shared<NC::Buffer>>();
-			m_worker = boost::async(
-				boost::launch::async,
+			m_downloading = true;
+			Global::Workers->submit(
+				ThreadPool::Priority::High, m_download,
 				std::bind(downloadLyrics,
-				          m_song, m_shared_buffer, m_download_stopper, m_fetcher));
+				          m_song, m_shared_buffer, m_download.flag(), m_fetcher),
+				[this](boost::optional<std::string> lyrics) {
+					finishDownload(lyrics);
+				});
 		}
 	}
 }
 
+void Lyrics::finishDownload(const boost::optional<std::string> &lyrics)
+{
+	// Show the rest of the progress first.
+	w << *m_shared_buffer->acquire();
+	if (lyrics)
+	{
+		w.clear();
+		w << Charset::utf8ToLocale(*lyrics);
+		if (!saveLyrics(m_song, *lyrics))
+			Statusbar::printf("Couldn't save lyrics in \"%1%\": %2%",
+			                  lyricsLocation(m_song), strerror(errno));
+	}
+	else
+		w << "\nLyrics were not found.\n";
+	clearWorker();
+	m_refresh_window = true;
+}
+
 void Lyrics::refetchCurrent()
 {
 	std::string filename = lyricsFilename(m_song);
-	if (std::remove(filename.c_str()) == -1 && errno != ENOENT)
+	if (isInLyricsDB(m_song) && !LyricsDB.remove(lyricsName(m_song)))
+	{
+		const char msg[] = "Couldn't remove lyrics from \"%1%\": %2%";
+		Statusbar::printf(msg, wideShorten(LyricsDB.path(), COLS - const_strlen(msg) - 25),
+		                  strerror(errno));
+	}
+	else if (std::remove(filename.c_str()) == -1 && errno != ENOENT)
 	{
 		const char msg[] = "Couldn't remove \"%1%\": %2%";
 		Statusbar::printf(msg, wideShorten(filename, COLS - const_strlen(msg) - 25),
@@ -322,9 +417,24 @@ void Lyrics::edit()
 		return;
 	}
 
+	std::string filename = lyricsFilename(m_song);
+
+	// Editor needs a file, so move lyrics out of the single file.
+	if (isInLyricsDB(m_song))
+	{
+		if (auto lyrics = LyricsDB.load(lyricsName(m_song)))
+		{
+			if (!saveLyrics(filename, *lyrics) || !LyricsDB.remove(lyricsName(m_song)))
+			{
+				Statusbar::printf("Couldn't move lyrics to \"%1%\": %2%",
+				                  filename, strerror(errno));
+				return;
+			}
+		}
+	}
+
 	Statusbar::print("Opening lyrics in external editor...");
 
-	std::string filename = lyricsFilename(m_song);
 	escapeSingleQuotes(filename);
 	if (Config.use_console_editor)
 	{
@@ -363,23 +473,103 @@ void Lyrics::toggleFetcher()
 
 void Lyrics::fetchInBackground(const MPD::Song &s, bool notify_)
 {
-	auto consumer_impl = [this] {
-		std::string lyrics_file;
+	auto consumer = m_consumer_state.acquire();
+	consumer->songs.emplace(s, notify_);
+	runConsumer(*consumer);
+}
+
+void Lyrics::prefetch(const std::vector<MPD::Song> &songs)
+{
+	auto consumer = m_consumer_state.acquire();
+	for (const auto &s : songs)
+	{
+		if (consumer->prefetched_songs.size() >= Config.lyrics_prefetch)
+			break;
+		if (consumer->prefetched_uris.insert(s.getURI()).second)
+		{
+			consumer->prefetched_songs.emplace(s, false);
+			consumer->prefetched_uris_order.push(s.getURI());
+			// Don't let the set grow indefinitely during long sessions.
+			if (consumer->prefetched_uris_order.size() > max_prefetched_uris)
+			{
+				consumer->prefetched_uris.erase(consumer->prefetched_uris_order.front());
+				consumer->prefetched_uris_order.pop();
+			}
+		}
+	}
+	runConsumer(*consumer);
+}
+
+void Lyrics::runConsumer(ConsumerState &consumer)
+{
+	// Start the consumer if it's not running.
+	if (!consumer.running)
+	{
+		submitConsumer();
+		consumer.running = true;
+	}
+}
+
+void Lyrics::submitConsumer()
+{
+	Global::Workers->submit(
+		ThreadPool::Priority::Low, ThreadPool::CancellationToken(),
+		std::bind(&Lyrics::consumeSongs, this),
+		[this](boost::optional<std::chrono::milliseconds> delay) {
+			// Consumer is still running, but it needs to wait before it
+			// downloads next prefetched lyrics. Don't block the thread.
+			if (delay)
+				Global::wFooter->eventLoop().addTimer(
+					*delay, std::bind(&Lyrics::submitConsumer, this));
+		});
+}
+
+boost::optional<std::chrono::milliseconds> Lyrics::consumeSongs()
+{
+	// Minimal interval between downloads of prefetched lyrics so that lyrics
+	// sites are not flooded with requests.
+	const auto prefetch_interval = std::chrono::seconds(2);
+
+	// If anything goes wrong, stop so that the consumer is started again when
+	// new songs come in. Otherwise it would be considered running forever.
+	auto stop = [this](std::string message) {
+		auto consumer = m_consumer_state.acquire();
+		consumer->running = false;
+		consumer->message = std::move(message);
+		return boost::none;
+	};
+
+	try
+	{
 		while (true)
 		{
 			ConsumerState::Song cs;
+			bool prefetched;
 			{
 				auto consumer = m_consumer_state.acquire();
 				assert(consumer->running);
-				if (consumer->songs.empty())
+				prefetched = consumer->songs.empty();
+				auto &songs = prefetched ? consumer->prefetched_songs : consumer->songs;
+				if (songs.empty())
 				{
 					consumer->running = false;
-					break;
+					return boost::none;
 				}
-				lyrics_file = lyricsFilename(consumer->songs.front().song());
-				if (!boost::filesystem::exists(lyrics_file))
+				auto now = std::chrono::steady_clock::now();
+				if (prefetched && now < consumer->next_prefetch)
 				{
-					cs = consumer->songs.front();
+					return std::chrono::duration_cast<std::chrono::milliseconds>(
+						consumer->next_prefetch - now) + std::chrono::milliseconds(1);
+				}
+				// Taken off the queue first, so that a song that can't be
+				// checked is not retried indefinitely.
+				auto song = std::move(songs.front());
+				songs.pop();
+				if (!lyricsExist(song.song()))
+				{
+					cs = std::move(song);
+					if (prefetched)
+						consumer->next_prefetch = now + prefetch_interval;
 					if (cs.notify())
 					{
 						consumer->message = "Fetching lyrics for \""
@@ -387,25 +577,28 @@ void Lyrics::fetchInBackground(const MPD::Song &s, bool notify_)
 							+ "\"...";
 					}
 				}
-				consumer->songs.pop();
 			}
 			if (!cs.song().empty())
 			{
 				auto lyrics = downloadLyrics(cs.song(), nullptr, nullptr, m_fetcher);
 				if (lyrics)
-					saveLyrics(lyrics_file, *lyrics);
+				{
+					// Don't shadow a separate file that wasn't imported into the
+					// single file. It's checked only now, after a download.
+					if (!isInLyricsDB(cs.song())
+					    || !boost::filesystem::exists(lyricsFilename(cs.song())))
+						saveLyrics(cs.song(), *lyrics);
+				}
 			}
 		}
-	};
-
-	auto consumer = m_consumer_state.acquire();
-	consumer->songs.emplace(s, notify_);
-	// Start the consumer if it's not running.
-	if (!consumer->running)
+	}
+	catch (std::exception &e)
+	{
+		return stop(std::string("Fetching lyrics failed: ") + e.what());
+	}
+	catch (...)
 	{
-		std::thread t(consumer_impl);
-		t.detach();
-		consumer->running = true;
+		return stop("Fetching lyrics failed");
 	}
 }
 
@@ -423,12 +616,13 @@ boost::optional<std::string> Lyrics::tryTakeConsumerMessage()
 
 void Lyrics::clearWorker()
 {
+	// The download might still be running, make sure its result is ignored.
+	stopDownload();
 	m_shared_buffer.reset();
-	m_worker = boost::BOOST_THREAD_FUTURE<boost::optional<std::string>>();
+	m_downloading = false;
 }
 
 void Lyrics::stopDownload()
 {
-	if (m_download_stopper)
-		m_download_stopper->store(true);
+	m_download.cancel();
 }
@@ -21,17 +21,18 @@
 #ifndef NCMPCPP_LYRICS_H
 #define NCMPCPP_LYRICS_H
 
-#include <atomic>
 #include <boost/optional.hpp>
-#include <boost/thread/future.hpp>
+#include <chrono>
 #include <memory>
 #include <queue>
+#include <unordered_set>
 
 #include "interfaces.h"
 #include "lyrics_fetcher.h"
 #include "screens/screen.h"
 #include "song.h"
 #include "utility/shared_resource.h"
+#include "utility/thread_pool.h"
 
 struct Lyrics: Screen<NC::Scrollpad>, Tabbable
 {
@@ -56,6 +57,7 @@ struct Lyrics: Screen<NC::Scrollpad>, Tabbable
 	void toggleFetcher();
 
 	void fetchInBackground(const MPD::Song &s, bool notify_);
+	void prefetch(const std::vector<MPD::Song> &songs);
 	boost::optional<std::string> tryTakeConsumerMessage();
 
 private:
@@ -86,8 +88,21 @@ private:
 		bool running;
 		std::queue<Song> songs;
 		boost::optional<std::string> message;
+
+		// Upcoming songs are fetched only if there are no other songs waiting
+		// and each of them only once (as long as it's among the most recently
+		// prefetched ones).
+		std::queue<Song> prefetched_songs;
+		std::unordered_set<std::string> prefetched_uris;
+		std::queue<std::string> prefetched_uris_order;
+		std::chrono::steady_clock::time_point next_prefetch;
 	};
 
+	void runConsumer(ConsumerState &consumer);
+	void submitConsumer();
+	boost::optional<std::chrono::milliseconds> consumeSongs();
+
+	void finishDownload(const boost::optional<std::string> &lyrics);
 	void clearWorker();
 	void stopDownload();
 
@@ -95,11 +110,11 @@ private:
 	size_t m_scroll_begin;
 
 	std::shared_ptr<Shared<NC::Buffer>> m_shared_buffer;
-	std::shared_ptr<std::atomic<bool>> m_download_stopper;
+	ThreadPool::CancellationToken m_download;
+	bool m_downloading;
 
 	MPD::Song m_song;
 	LyricsFetcher *m_fetcher;
-	boost::BOOST_THREAD_FUTURE<boost::optional<std::string>> m_worker;
 
 	Shared<ConsumerState> m_consumer_state;
 };
@@ -18,11 +18,11 @@
  *   51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.              *
  ***************************************************************************/
 
-#include <boost/date_time/posix_time/posix_time.hpp>
 #include <boost/locale/conversion.hpp>
 #include <algorithm>
 #include <array>
 #include <cassert>
+#include <chrono>
 
 #include "charset.h"
 #include "display.h"
@@ -185,9 +185,8 @@ public:
 }
 
 MediaLibrary::MediaLibrary()
-: m_timer(boost::posix_time::from_time_t(0))
-, m_window_timeout(Config.data_fetching_delay ? 250 : BaseScreen::defaultWindowTimeout)
-, m_fetching_delay(boost::posix_time::milliseconds(Config.data_fetching_delay ? 250 : -1))
+: m_fetching_delay_elapsed(true)
+, m_fetching_timer(0)
 {
 	hasTwoColumns = 0;
 	isAlbumOnly = 0;
@@ -213,7 +212,10 @@ MediaLibrary::MediaLibrary()
 		if (tag.empty())
 			menu << Config.empty_tag;
 		else
-			menu << Charset::utf8ToLocale(tag);
+		{
+			std::string buffer;
+			menu << Charset::utf8ToLocale(tag, buffer);
+		}
 	});
 	
 	Albums = NC::Menu<AlbumEntry>(itsMiddleColStartX, MainStartY, itsMiddleColWidth, MainHeight, Config.titles_visibility ? "Albums" : "", Config.main_color, NC::Border());
@@ -422,7 +424,7 @@ void MediaLibrary::update()
 		{
 			ScopedUnfilteredMenu<AlbumEntry> sunfilter_albums(ReapplyFilter::No, Albums);
 			if (!Tags.empty()
-			    && ((Albums.empty() && Global::Timer - m_timer > m_fetching_delay)
+			    && ((Albums.empty() && m_fetching_delay_elapsed)
 			        || m_albums_update_request))
 			{
 				m_albums_update_request = false;
@@ -471,7 +473,7 @@ void MediaLibrary::update()
 
 	ScopedUnfilteredMenu<MPD::Song> sunfilter_songs(ReapplyFilter::No, Songs);
 	if (!Albums.empty()
-	    && ((Songs.empty() && Global::Timer - m_timer > m_fetching_delay)
+	    && ((Songs.empty() && m_fetching_delay_elapsed)
 	        || m_songs_update_request))
 	{
 		m_songs_update_request = false;
@@ -492,16 +494,6 @@ void MediaLibrary::update()
 	}
 }
 
-int MediaLibrary::windowTimeout()
-{
-	ScopedUnfilteredMenu<AlbumEntry> sunfilter_albums(ReapplyFilter::No, Albums);
-	ScopedUnfilteredMenu<MPD::Song> sunfilter_songs(ReapplyFilter::No, Songs);
-	if (Albums.empty() || Songs.empty())
-		return m_window_timeout;
-	else
-		return Screen<WindowType>::windowTimeout();
-}
-
 void MediaLibrary::mouseButtonPressed(MEVENT me)
 {
 	auto tryNextColumn = [this]() -> bool {
@@ -911,7 +903,16 @@ void MediaLibrary::nextColumn()
 
 void MediaLibrary::updateTimer()
 {
-	m_timer = Global::Timer;
+	if (!Config.data_fetching_delay)
+		return;
+	// Fetching data is postponed until the selection settles, the timer wakes
+	// up the main loop when it does.
+	auto &loop = Global::wFooter->eventLoop();
+	loop.cancelTimer(m_fetching_timer);
+	m_fetching_delay_elapsed = false;
+	m_fetching_timer = loop.addTimer(std::chrono::milliseconds(250), [this] {
+		m_fetching_delay_elapsed = true;
+	});
 }
 
 void MediaLibrary::toggleColumnsMode()
@@ -21,8 +21,6 @@
 #ifndef NCMPCPP_MEDIA_LIBRARY_H
 #define NCMPCPP_MEDIA_LIBRARY_H
 
-#include <boost/date_time/posix_time/posix_time_types.hpp>
-
 #include "interfaces.h"
 #include "regex_filter.h"
 #include "screens/screen.h"
@@ -41,7 +39,6 @@ struct MediaLibrary: Screen<NC::Window *>, Filterable, HasColumns, HasSongs, Sea
 	virtual void refresh() override;
 	virtual void update() override;
 	
-	virtual int windowTimeout() override;
 
 	virtual void mouseButtonPressed(MEVENT me) override;
 	
@@ -143,10 +140,8 @@ private:
 	bool m_albums_update_request;
 	bool m_songs_update_request;
 
-	boost::posix_time::ptime m_timer;
-
-	const int m_window_timeout;
-	const boost::posix_time::time_duration m_fetching_delay;
+	bool m_fetching_delay_elapsed;
+	NC::EventLoop::TimerID m_fetching_timer;
 
 	Regex::Filter<PrimaryTag> m_tags_search_predicate;
 	Regex::ItemFilter<AlbumEntry> m_albums_search_predicate;
@@ -53,7 +53,7 @@ bool playlistEntryMatcher(const Regex::Regex &rx, const MPD::Song &s);
 
 Playlist::Playlist()
 : m_total_length(0), m_remaining_time(0), m_scroll_begin(0)
-, m_timer(boost::posix_time::from_time_t(0))
+, m_highlight_expired(false), m_highlight_timer(0)
 , m_reload_total_length(false), m_reload_remaining(false)
 {
 	w = NC::Menu<MPD::Song>(0, MainStartY, COLS, MainHeight, Config.playlist_display_mode == DisplayMode::Columns && Config.titles_visibility ? Display::Columns(COLS) : "", Config.main_color, NC::Border());
@@ -122,10 +122,9 @@ std::wstring Playlist::title()
 
 void Playlist::update()
 {
-	if (w.isHighlighted()
-	&&  Config.playlist_disable_highlight_delay.time_duration::seconds() > 0
-	&&  Global::Timer - m_timer > Config.playlist_disable_highlight_delay)
+	if (w.isHighlighted() && m_highlight_expired)
 	{
+		m_highlight_expired = false;
 		w.setHighlighting(false);
 		w.refresh();
 	}
@@ -238,6 +237,42 @@ MPD::Song Playlist::nowPlayingSong()
 	return s;
 }
 
+std::vector<MPD::Song> Playlist::upcomingSongs(size_t count)
+{
+	std::vector<MPD::Song> result;
+	// In single mode playback stops after the current song.
+	if (count == 0 || Status::State::single())
+		return result;
+
+	ScopedUnfilteredMenu<MPD::Song> sunfilter(ReapplyFilter::No, w);
+	auto sp = Status::State::nextSongPosition();
+	if (sp < 0 || size_t(sp) >= w.size())
+		return result;
+	result.push_back(w.at(sp).value());
+
+	// In random mode only the next song is known.
+	if (Status::State::random())
+		return result;
+
+	// Playback continues from the beginning of the playlist in repeat mode,
+	// unless songs that were already played are removed.
+	const bool wrap = Status::State::repeat() && !Status::State::consume();
+	size_t pos = sp;
+	while (result.size() < count)
+	{
+		if (++pos == w.size())
+		{
+			if (!wrap)
+				break;
+			pos = 0;
+		}
+		if (pos == size_t(sp) || int(pos) == Status::State::currentSongPosition())
+			break;
+		result.push_back(w.at(pos).value());
+	}
+	return result;
+}
+
 void Playlist::locateSong(const MPD::Song &s)
 {
 	if (!w.isFiltered())
@@ -259,7 +294,14 @@ void Playlist::locateSong(const MPD::Song &s)
 void Playlist::enableHighlighting()
 {
 	w.setHighlighting(true);
-	m_timer = Global::Timer;
+	auto &loop = Global::wFooter->eventLoop();
+	loop.cancelTimer(m_highlight_timer);
+	m_highlight_expired = false;
+	auto delay = Config.playlist_disable_highlight_delay.total_milliseconds();
+	if (delay > 0)
+		m_highlight_timer = loop.addTimer(std::chrono::milliseconds(delay), [this] {
+			m_highlight_expired = true;
+		});
 }
 
 std::string Playlist::getTotalLength()
@@ -268,17 +310,25 @@ std::string Playlist::getTotalLength()
 	
 	if (m_reload_total_length)
 	{
-		m_total_length = 0;
-		for (const auto &s : w)
-			m_total_length += s.value().getDuration();
+		// total length of the filtered playlist can't be deduced from durations
+		// of all songs, so it needs to be summed up explicitly.
+		if (w.isFiltered())
+		{
+			m_total_length = 0;
+			for (const auto &s : w)
+				m_total_length += s.value().getDuration();
+		}
+		else
+			m_total_length = m_durations.total();
 		m_reload_total_length = false;
 	}
 	if (Config.playlist_show_remaining_time && m_reload_remaining)
 	{
-		ScopedUnfilteredMenu<MPD::Song> sunfilter(ReapplyFilter::No, w);
-		m_remaining_time = 0;
-		for (size_t i = Status::State::currentSongPosition(); i < w.size(); ++i)
-			m_remaining_time += w[i].value().getDuration();
+		size_t pos = Status::State::currentSongPosition();
+		if (pos < m_durations.size())
+			m_remaining_time = m_durations.total() - m_durations.prefixSum(pos);
+		else
+			m_remaining_time = 0;
 		m_reload_remaining = false;
 	}
 	
@@ -314,6 +364,23 @@ void Playlist::setSelectedItemsPriority(int prio)
 	Statusbar::print("Priority set");
 }
 
+void Playlist::setSongDuration(size_t pos, unsigned duration)
+{
+	if (pos < m_durations.size())
+		m_durations.set(pos, duration);
+	else
+	{
+		while (m_durations.size() < pos)
+			m_durations.push_back(0);
+		m_durations.push_back(duration);
+	}
+}
+
+void Playlist::truncateSongDurations(size_t size)
+{
+	m_durations.truncate(size);
+}
+
 bool Playlist::checkForSong(const MPD::Song &s)
 {
 	return m_song_refs.find(s) != m_song_refs.end();
@@ -21,7 +21,6 @@
 #ifndef NCMPCPP_PLAYLIST_H
 #define NCMPCPP_PLAYLIST_H
 
-#include <boost/date_time/posix_time/posix_time_types.hpp>
 #include <unordered_map>
 
 #include "interfaces.h"
@@ -29,6 +28,7 @@
 #include "screens/screen.h"
 #include "song.h"
 #include "song_list.h"
+#include "utility/fenwick_tree.h"
 
 struct Playlist: Screen<SongMenu>, Filterable, HasSongs, Searchable, Tabbable
 {
@@ -67,6 +67,7 @@ struct Playlist: Screen<SongMenu>, Filterable, HasSongs, Searchable, Tabbable
 	
 	// other members
 	MPD::Song nowPlayingSong();
+	std::vector<MPD::Song> upcomingSongs(size_t count);
 
 	// Locate song in playlist.
 	void locateSong(const MPD::Song &s);
@@ -79,6 +80,11 @@ struct Playlist: Screen<SongMenu>, Filterable, HasSongs, Searchable, Tabbable
 	void registerSong(const MPD::Song &s);
 	void unregisterSong(const MPD::Song &s);
 	
+	// Keep track of durations of songs at given positions of the
+	// (unfiltered) playlist so that total and remaining time are cheap.
+	void setSongDuration(size_t pos, unsigned duration);
+	void truncateSongDurations(size_t size);
+
 	void reloadTotalLength() { m_reload_total_length = true; }
 	void reloadRemaining() { m_reload_remaining = true; }
 	
@@ -88,12 +94,14 @@ private:
 	std::string m_stats;
 	
 	std::unordered_map<MPD::Song, int, MPD::Song::Hash> m_song_refs;
+	FenwickTree<size_t> m_durations;
 	
-	size_t m_total_length;;
+	size_t m_total_length;
 	size_t m_remaining_time;
 	size_t m_scroll_begin;
 	
-	boost::posix_time::ptime m_timer;
+	bool m_highlight_expired;
+	NC::EventLoop::TimerID m_highlight_timer;
 
 	bool m_reload_total_length;
 	bool m_reload_remaining;
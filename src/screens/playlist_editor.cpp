@@ -20,8 +20,8 @@
 
 #include <algorithm>
 #include <boost/optional.hpp>
-#include <boost/date_time/posix_time/posix_time.hpp>
 #include <cassert>
+#include <chrono>
 
 #include "curses/menu_impl.h"
 #include "charset.h"
@@ -62,9 +62,8 @@ boost::optional<size_t> GetSongIndexInPlaylist(MPD::Playlist playlist, const MPD
 }
 
 PlaylistEditor::PlaylistEditor()
-: m_timer(boost::posix_time::from_time_t(0))
-, m_window_timeout(Config.data_fetching_delay ? 250 : BaseScreen::defaultWindowTimeout)
-, m_fetching_delay(boost::posix_time::milliseconds(Config.data_fetching_delay ? 250 : -1))
+: m_fetching_delay_elapsed(true)
+, m_fetching_timer(0)
 {
 	size_t ra = Config.playlist_editor_column_width_ratio[0];
 	size_t rb = Config.playlist_editor_column_width_ratio[1];
@@ -81,7 +80,8 @@ PlaylistEditor::PlaylistEditor()
 	Playlists.setSelectedPrefix(Config.selected_item_prefix);
 	Playlists.setSelectedSuffix(Config.selected_item_suffix);
 	Playlists.setItemDisplayer([](NC::Menu<MPD::Playlist> &menu) {
-		menu << Charset::utf8ToLocale(menu.drawn()->value().path());
+		std::string buffer;
+		menu << Charset::utf8ToLocale(menu.drawn()->value().path(), buffer);
 	});
 	
 	Content = NC::Menu<MPD::Song>(RightColumnStartX, MainStartY, RightColumnWidth, MainHeight, Config.titles_visibility ? "Content" : "", Config.main_color, NC::Border());
@@ -184,7 +184,7 @@ void PlaylistEditor::update()
 	{
 		ScopedUnfilteredMenu<MPD::Song> sunfilter_content(ReapplyFilter::No, Content);
 		if (!Playlists.empty()
-		    && ((Content.empty() && Global::Timer - m_timer > m_fetching_delay)
+		    && ((Content.empty() && m_fetching_delay_elapsed)
 		        || m_content_update_requested))
 		{
 			m_content_update_requested = false;
@@ -214,15 +214,6 @@ void PlaylistEditor::update()
 	}
 }
 
-int PlaylistEditor::windowTimeout()
-{
-	ScopedUnfilteredMenu<MPD::Song> sunfilter_content(ReapplyFilter::No, Content);
-	if (Content.empty())
-		return m_window_timeout;
-	else
-		return Screen<WindowType>::windowTimeout();
-}
-
 void PlaylistEditor::mouseButtonPressed(MEVENT me)
 {
 	if (Playlists.hasCoords(me.x, me.y))
@@ -488,7 +479,14 @@ void PlaylistEditor::nextColumn()
 
 void PlaylistEditor::updateTimer()
 {
-	m_timer = Global::Timer;
+	if (!Config.data_fetching_delay)
+		return;
+	auto &loop = Global::wFooter->eventLoop();
+	loop.cancelTimer(m_fetching_timer);
+	m_fetching_delay_elapsed = false;
+	m_fetching_timer = loop.addTimer(std::chrono::milliseconds(250), [this] {
+		m_fetching_delay_elapsed = true;
+	});
 }
 
 void PlaylistEditor::locatePlaylist(const MPD::Playlist &playlist)
@@ -21,8 +21,6 @@
 #ifndef NCMPCPP_PLAYLIST_EDITOR_H
 #define NCMPCPP_PLAYLIST_EDITOR_H
 
-#include <boost/date_time/posix_time/posix_time_types.hpp>
-
 #include "interfaces.h"
 #include "regex_filter.h"
 #include "screens/screen.h"
@@ -41,7 +39,6 @@ struct PlaylistEditor: Screen<NC::Window *>, Filterable, HasColumns, HasSongs, S
 	virtual void refresh() override;
 	virtual void update() override;
 	
-	virtual int windowTimeout() override;
 
 	virtual void mouseButtonPressed(MEVENT me) override;
 	
@@ -88,10 +85,8 @@ private:
 	bool m_playlists_update_requested;
 	bool m_content_update_requested;
 
-	boost::posix_time::ptime m_timer;
-
-	const int m_window_timeout;
-	const boost::posix_time::time_duration m_fetching_delay;
+	bool m_fetching_delay_elapsed;
+	NC::EventLoop::TimerID m_fetching_timer;
 
 	Regex::Filter<MPD::Playlist> m_playlists_search_predicate;
 	Regex::Filter<MPD::Song> m_content_search_predicate;
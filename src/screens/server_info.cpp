@@ -33,7 +33,8 @@ using Global::MainStartY;
 ServerInfo *myServerInfo;
 
 ServerInfo::ServerInfo()
-: m_timer(boost::posix_time::from_time_t(0))
+: m_update_requested(false)
+, m_timer(0)
 {
 	SetDimensions();
 	w = NC::Scrollpad((COLS-m_width)/2, (MainHeight-m_height)/2+MainStartY, m_width, m_height, "MPD server info", Config.main_color, Config.window_border);
@@ -59,6 +60,22 @@ void ServerInfo::switchTo()
 			std::make_move_iterator(MPD::StringIterator()),
 			std::back_inserter(m_tag_types)
 		);
+
+		// Statistics are refreshed every second while the screen is visible.
+		m_update_requested = true;
+		if (m_timer == 0)
+		{
+			auto &loop = Global::wFooter->eventLoop();
+			m_timer = loop.addPeriodicTimer(std::chrono::seconds(1), [this, &loop] {
+				if (Global::myScreen == this)
+					m_update_requested = true;
+				else
+				{
+					loop.cancelTimer(m_timer);
+					m_timer = 0;
+				}
+			});
+		}
 	}
 	else
 		switchToPreviousScreen();
@@ -84,9 +101,9 @@ std::wstring ServerInfo::title()
 
 void ServerInfo::update()
 {
-	if (Global::Timer - m_timer < boost::posix_time::seconds(1))
+	if (!m_update_requested)
 		return;
-	m_timer = Global::Timer;
+	m_update_requested = false;
 	
 	MPD::Statistics stats = Mpd.getStatistics();
 	if (stats.empty())
@@ -21,8 +21,6 @@
 #ifndef NCMPCPP_SERVER_INFO_H
 #define NCMPCPP_SERVER_INFO_H
 
-#include <boost/date_time/posix_time/posix_time_types.hpp>
-
 #include "interfaces.h"
 #include "screens/screen.h"
 
@@ -45,7 +43,8 @@ struct ServerInfo: Screen<NC::Scrollpad>, Tabbable
 private:
 	void SetDimensions();
 	
-	boost::posix_time::ptime m_timer;
+	bool m_update_requested;
+	NC::EventLoop::TimerID m_timer;
 
 	std::vector<std::string> m_url_handlers;
 	std::vector<std::string> m_tag_types;
@@ -23,15 +23,20 @@
 #ifdef ENABLE_VISUALIZER
 
 #include <algorithm>
+#include <numeric>
 #include <boost/date_time/posix_time/posix_time.hpp>
 #include <boost/math/constants/constants.hpp>
 #include <cerrno>
+#include <chrono>
 #include <cmath>
 #include <cstring>
 #include <fstream>
 #include <limits>
+#include <random>
+#include <sstream>
 #include <fcntl.h>
 #include <netdb.h>
+#include <poll.h>
 #include <cassert>
 
 #include "global.h"
@@ -42,6 +47,7 @@
 #include "screens/screen_switcher.h"
 #include "status.h"
 #include "enums.h"
+#include "utility/pcm.h"
 #include "utility/wide_string.h"
 
 using Samples = std::vector<int16_t>;
@@ -71,10 +77,12 @@ Visualizer::Visualizer()
 : Screen(NC::Window(0, MainStartY, COLS, MainHeight, "", NC::Color::Default, NC::Border()))
 , m_output_id(-1)
 , m_reset_output(false)
+, m_stats_frames(0)
+, m_stats_render_time(0)
+, m_achieved_fps(0)
+, m_render_time_ms(0)
 , m_source_fd(-1)
-, m_sample_consumption_rate(5)
-, m_sample_consumption_rate_up_ctr(0)
-, m_sample_consumption_rate_dn_ctr(0)
+, m_capture_stopped(true)
 #	ifdef HAVE_FFTW3_H
 	,
   DFT_NONZERO_SIZE(2048 * (2*Config.visualizer_spectrum_dft_size + 4)),
@@ -88,13 +96,27 @@ Visualizer::Visualizer()
 {
 	InitDataSource();
 	InitVisualization();
+	// Enough for 500ms of stereo samples.
+	m_captured_samples.resize(m_source_format.rate);
 #	ifdef HAVE_FFTW3_H
 	m_fftw_results = DFT_TOTAL_SIZE/2+1;
 	m_freq_magnitudes.resize(m_fftw_results);
-	m_fftw_input = static_cast<double *>(fftw_malloc(sizeof(double)*DFT_TOTAL_SIZE));
-	memset(m_fftw_input, 0, sizeof(double)*DFT_TOTAL_SIZE);
-	m_fftw_output = static_cast<fftw_complex *>(fftw_malloc(sizeof(fftw_complex)*m_fftw_results));
-	m_fftw_plan = fftw_plan_dft_r2c_1d(DFT_TOTAL_SIZE, m_fftw_input, m_fftw_output, FFTW_ESTIMATE);
+	m_fftw_input = static_cast<float *>(fftwf_malloc(sizeof(float)*DFT_TOTAL_SIZE));
+	m_fftw_output = static_cast<fftwf_complex *>(fftwf_malloc(sizeof(fftwf_complex)*m_fftw_results));
+	// Measuring the best plan takes a while, so results are kept in a wisdom
+	// file and reused on subsequent runs.
+	const std::string wisdom_path = Config.ncmpcpp_directory + "fftw_wisdom";
+	fftwf_import_wisdom_from_filename(wisdom_path.c_str());
+	m_fftw_plan = fftwf_plan_dft_r2c_1d(DFT_TOTAL_SIZE, m_fftw_input, m_fftw_output, FFTW_MEASURE);
+	fftwf_export_wisdom_to_filename(wisdom_path.c_str());
+	// Planning with FFTW_MEASURE overwrites the input.
+	memset(m_fftw_input, 0, sizeof(float)*DFT_TOTAL_SIZE);
+	GenWindow();
+	m_spectrum_hop = std::max<size_t>(
+		1, DFT_NONZERO_SIZE * (100 - Config.visualizer_spectrum_overlap) / 100);
+	m_spectrum_pending_samples = 0;
+	m_spectrum_transform = true;
+	m_column_bins.resize(1);
 	m_dft_logspace.reserve(500);
 	m_bar_heights.reserve(100);
 #	endif // HAVE_FFTW3_H
@@ -128,7 +150,11 @@ void Visualizer::resize()
 
 std::wstring Visualizer::title()
 {
-	return L"Music visualizer";
+	std::wstring result = L"Music visualizer";
+	if (Config.visualizer_show_statistics && m_achieved_fps > 0)
+		result += (boost::wformat(L" (%1$.1f fps, %2$.1f ms per frame)")
+		           % m_achieved_fps % m_render_time_ms).str();
+	return result;
 }
 
 void Visualizer::update()
@@ -146,122 +172,146 @@ void Visualizer::update()
 		m_reset_output = false;
 	}
 
-	// PCM in format 44100:16:1 (for mono visualization) and
-	// 44100:16:2 (for stereo visualization) is supported.
-	ssize_t bytes_read = read(m_source_fd, m_incoming_samples.data(),
-	                          sizeof(int16_t) * m_incoming_samples.size());
-	if (bytes_read > 0)
+	// Frames are rendered at absolute deadlines, so waking up early because of
+	// other events doesn't shift them. If rendering falls behind, missed frames
+	// are skipped instead of being rendered in quick succession.
+	const auto frame_start = FrameClock::now();
+	if (frame_start < m_next_frame)
+		return;
+	const auto period = FramePeriod();
+	const auto behind = frame_start - m_next_frame;
+	m_next_frame += (behind / period + 1) * period;
+	UpdateStatistics(frame_start);
+
+	// Samples are already converted to 16 bits and the number of channels
+	// that is visualized by the capture thread.
+	size_t incoming_samples = m_captured_samples.read(
+		m_incoming_samples.data(), m_incoming_samples.size());
+	if (incoming_samples > 0)
 	{
-		const auto begin = m_incoming_samples.begin();
-		const auto end = m_incoming_samples.begin() + bytes_read/sizeof(int16_t);
-
 		if (Config.visualizer_autoscale)
 		{
 			m_auto_scale_multiplier += 1.0/Config.visualizer_fps;
-			for (auto sample = begin; sample != end; ++sample)
-			{
-				double scale = std::numeric_limits<int16_t>::min();
-				scale /= *sample;
-				scale = fabs(scale);
-				if (scale < m_auto_scale_multiplier)
-					m_auto_scale_multiplier = scale;
-			}
-			for (auto sample = begin; sample != end; ++sample)
-			{
-				int32_t tmp = *sample;
-				if (m_auto_scale_multiplier <= 50.0) // limit the auto scale
-					tmp *= m_auto_scale_multiplier;
-				if (tmp < std::numeric_limits<int16_t>::min())
-					*sample = std::numeric_limits<int16_t>::min();
-				else if (tmp > std::numeric_limits<int16_t>::max())
-					*sample = std::numeric_limits<int16_t>::max();
-				else
-					*sample = tmp;
-			}
+			int32_t peak = pcmPeak(m_incoming_samples.data(), incoming_samples);
+			if (peak > 0)
+				m_auto_scale_multiplier = std::min(
+					m_auto_scale_multiplier,
+					-double(std::numeric_limits<int16_t>::min()) / peak);
+			if (m_auto_scale_multiplier <= 50.0) // limit the auto scale
+				pcmScale(m_incoming_samples.data(), incoming_samples, m_auto_scale_multiplier);
 		}
-		m_buffered_samples.put(begin, end);
+		m_buffered_samples.put(m_incoming_samples.data(), incoming_samples);
 	}
 
-	size_t requested_samples =
-		44100.0 / Config.visualizer_fps * pow(1.1, m_sample_consumption_rate);
-	if (Config.visualizer_in_stereo)
-		requested_samples *= 2;
-
-	//Statusbar::printf("Samples: %1%, %2%, %3%", m_buffered_samples.size(),
-	//                  requested_samples, m_sample_consumption_rate);
-
-	size_t new_samples = m_buffered_samples.get(requested_samples, m_rendered_samples);
+	// Consume one frame worth of samples, unless rendering falls behind. Then
+	// consume enough for the backlog not to exceed one frame.
+	const size_t channels = Config.visualizer_in_stereo ? 2 : 1;
+	const size_t frame_samples = m_source_format.rate / Config.visualizer_fps * channels;
+	size_t requested_samples = std::max(
+		frame_samples,
+		m_buffered_samples.size() > frame_samples
+		? m_buffered_samples.size() - frame_samples
+		: 0);
+	requested_samples -= requested_samples % channels;
+
+	size_t new_samples = m_buffered_samples.consume(requested_samples);
 	if (new_samples == 0)
 		return;
 
-	// A crude way to adjust the amount of samples consumed from the buffer
-	// depending on how fast the rendering is.
-	if (m_buffered_samples.size() > 0)
-	{
-		if (++m_sample_consumption_rate_up_ctr > 8)
-		{
-			m_sample_consumption_rate_up_ctr = 0;
-			++m_sample_consumption_rate;
-		}
-	}
-	else if (m_sample_consumption_rate > 0)
-	{
-		if (++m_sample_consumption_rate_dn_ctr > 4)
-		{
-			m_sample_consumption_rate_dn_ctr = 0;
-			--m_sample_consumption_rate;
-		}
-		m_sample_consumption_rate_up_ctr = 0;
-	}
+#	ifdef HAVE_FFTW3_H
+	AdvanceSpectrum(new_samples / channels);
+#	endif // HAVE_FFTW3_H
+	Render();
 
-	w.clear();
+	++m_stats_frames;
+	m_stats_render_time += FrameClock::now() - frame_start;
+}
+
+void Visualizer::Render()
+{
+	// Samples are read in place, the window is split in two at the end of the
+	// buffer.
+	auto samples = m_buffered_samples.window();
 	if (Config.visualizer_in_stereo)
 	{
-		auto chan_samples = m_rendered_samples.size()/2;
-		int16_t buf_left[chan_samples], buf_right[chan_samples];
-		for (size_t i = 0, j = 0; i < m_rendered_samples.size(); i += 2, ++j)
-		{
-			buf_left[j] = m_rendered_samples[i];
-			buf_right[j] = m_rendered_samples[i+1];
-		}
+		// Both parts hold whole frames as the capacity of the buffer is even.
+		auto chan_samples = samples.size()/2;
+		auto first_frames = samples.first_size/2;
+		m_left_samples.resize(chan_samples);
+		m_right_samples.resize(chan_samples);
+		pcmDeinterleave(samples.first, first_frames,
+		                m_left_samples.data(), m_right_samples.data());
+		pcmDeinterleave(samples.second, chan_samples - first_frames,
+		                m_left_samples.data() + first_frames,
+		                m_right_samples.data() + first_frames);
 		size_t half_height = w.getHeight()/2;
 
-		(this->*drawStereo)(buf_left, buf_right, chan_samples, half_height);
+		(this->*drawStereo)(SampleBuffer::Span(m_left_samples.data(), chan_samples),
+		                    SampleBuffer::Span(m_right_samples.data(), chan_samples),
+		                    half_height);
 	}
 	else
 	{
-		(this->*draw)(m_rendered_samples.data(), m_rendered_samples.size(), 0, w.getHeight());
+		(this->*draw)(samples, 0, w.getHeight());
 	}
+	FlushFrame();
 	w.refresh();
 }
 
 int Visualizer::windowTimeout()
 {
 	if (m_source_fd >= 0 && Status::State::player() == MPD::psPlay)
-		return 1000/Config.visualizer_fps;
+	{
+		// Round up so that we don't wake up before the deadline.
+		auto remaining = m_next_frame - FrameClock::now();
+		auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+			remaining + std::chrono::milliseconds(1) - FrameClock::duration(1));
+		return std::max<int>(0, ms.count());
+	}
 	else
 		return Screen<WindowType>::windowTimeout();
 }
 
+Visualizer::FrameClock::duration Visualizer::FramePeriod() const
+{
+	return std::chrono::duration_cast<FrameClock::duration>(
+		std::chrono::duration<double>(1.0 / Config.visualizer_fps));
+}
+
+void Visualizer::UpdateStatistics(FrameClock::time_point now)
+{
+	const auto elapsed = now - m_stats_start;
+	if (elapsed < std::chrono::seconds(1))
+		return;
+	const double old_fps = m_achieved_fps;
+	m_achieved_fps = m_stats_frames / std::chrono::duration<double>(elapsed).count();
+	m_render_time_ms = m_stats_frames > 0
+		? std::chrono::duration<double, std::milli>(m_stats_render_time).count() / m_stats_frames
+		: 0;
+	m_stats_start = now;
+	m_stats_frames = 0;
+	m_stats_render_time = FrameClock::duration(0);
+	if (Config.visualizer_show_statistics
+	    && Global::myScreen == this && (m_achieved_fps > 0 || old_fps > 0))
+		drawHeader();
+}
+
 /**********************************************************************/
 
-void Visualizer::DrawSoundWave(const int16_t *buf, ssize_t samples, size_t y_offset, size_t height)
+void Visualizer::DrawSoundWave(const SampleBuffer::Span &buf, size_t y_offset, size_t height)
 {
 	const size_t half_height = height/2;
 	const size_t base_y = y_offset+half_height;
 	const size_t win_width = w.getWidth();
-	const int samples_per_column = samples/win_width;
+	const int samples_per_column = buf.size()/win_width;
 
 	// too little samples
 	if (samples_per_column == 0)
 		return;
 
 	auto draw_point = [&](size_t x, int32_t y) {
-		auto c = toColor(std::abs(y), half_height, false);
-		w << NC::XY(x, base_y+y)
-		  << c
-		  << Config.visualizer_chars[0]
-		  << NC::FormattedColor::End<>(c);
+		DrawCell(x, base_y+y, Config.visualizer_chars[0],
+		         toColor(std::abs(y), half_height, false));
 	};
 
 	int32_t point_y, prev_point_y = 0;
@@ -297,10 +347,10 @@ void Visualizer::DrawSoundWave(const int16_t *buf, ssize_t samples, size_t y_off
 	}
 }
 
-void Visualizer::DrawSoundWaveStereo(const int16_t *buf_left, const int16_t *buf_right, ssize_t samples, size_t height)
+void Visualizer::DrawSoundWaveStereo(const SampleBuffer::Span &buf_left, const SampleBuffer::Span &buf_right, size_t height)
 {
-	DrawSoundWave(buf_left, samples, 0, height);
-	DrawSoundWave(buf_right, samples, height, w.getHeight() - height);
+	DrawSoundWave(buf_left, 0, height);
+	DrawSoundWave(buf_right, height, w.getHeight() - height);
 }
 
 /**********************************************************************/
@@ -309,12 +359,12 @@ void Visualizer::DrawSoundWaveStereo(const int16_t *buf_left, const int16_t *buf
 // instead of a single line the entire height is filled. In stereo mode, the top
 // half of the screen is dedicated to the right channel, the bottom the left
 // channel.
-void Visualizer::DrawSoundWaveFill(const int16_t *buf, ssize_t samples, size_t y_offset, size_t height)
+void Visualizer::DrawSoundWaveFill(const SampleBuffer::Span &buf, size_t y_offset, size_t height)
 {
 	// if right channel is drawn, bars descend from the top to the bottom
 	const bool flipped = y_offset > 0;
 	const size_t win_width = w.getWidth();
-	const int samples_per_column = samples/win_width;
+	const int samples_per_column = buf.size()/win_width;
 
 	// too little samples
 	if (samples_per_column == 0)
@@ -334,27 +384,24 @@ void Visualizer::DrawSoundWaveFill(const int16_t *buf, ssize_t samples, size_t y
 
 		for (int32_t j = 0; j < point_y; ++j)
 		{
-			auto c = toColor(j, height, false);
 			size_t y = flipped ? y_offset+j : y_offset+height-j-1;
-			w << NC::XY(x, y)
-			  << c
-			  << Config.visualizer_chars[1]
-			  << NC::FormattedColor::End<>(c);
+			DrawCell(x, y, Config.visualizer_chars[1], toColor(j, height, false));
 		}
 	}
 }
 
-void Visualizer::DrawSoundWaveFillStereo(const int16_t *buf_left, const int16_t *buf_right, ssize_t samples, size_t height)
+void Visualizer::DrawSoundWaveFillStereo(const SampleBuffer::Span &buf_left, const SampleBuffer::Span &buf_right, size_t height)
 {
-	DrawSoundWaveFill(buf_left, samples, 0, height);
-	DrawSoundWaveFill(buf_right, samples, height, w.getHeight() - height);
+	DrawSoundWaveFill(buf_left, 0, height);
+	DrawSoundWaveFill(buf_right, height, w.getHeight() - height);
 }
 
 /**********************************************************************/
 
 // Draws the sound wave as an ellipse with origin in the center of the screen.
-void Visualizer::DrawSoundEllipse(const int16_t *buf, ssize_t samples, size_t, size_t height)
+void Visualizer::DrawSoundEllipse(const SampleBuffer::Span &buf, size_t, size_t height)
 {
+	const size_t samples = buf.size();
 	const size_t half_width = w.getWidth()/2;
 	const size_t half_height = height/2;
 
@@ -363,7 +410,7 @@ void Visualizer::DrawSoundEllipse(const int16_t *buf, ssize_t samples, size_t, s
 
 	int32_t x, y;
 	double radius, max_radius;
-	for (ssize_t i = 0; i < samples; ++i)
+	for (size_t i = 0; i < samples; ++i)
 	{
 		x = half_width * std::cos(i*deg_multiplier);
 		y = half_height * std::sin(i*deg_multiplier);
@@ -378,11 +425,8 @@ void Visualizer::DrawSoundEllipse(const int16_t *buf, ssize_t samples, size_t, s
 		x *= radius;
 		y *= radius;
 
-		auto c = toColor(sqrt(x*x + y*y), max_radius, false);
-		w << NC::XY(half_width + x, half_height + y)
-		  << c
-		  << Config.visualizer_chars[0]
-		  << NC::FormattedColor::End<>(c);
+		DrawCell(half_width + x, half_height + y, Config.visualizer_chars[0],
+		         toColor(sqrt(x*x + y*y), max_radius, false));
 	}
 }
 
@@ -396,8 +440,9 @@ void Visualizer::DrawSoundEllipse(const int16_t *buf, ssize_t samples, size_t, s
 // circle. This visualizer assume the font height is twice the length of the
 // font's width. If the font is skinner or wider than this, instead of a circle
 // it will be an ellipse.
-void Visualizer::DrawSoundEllipseStereo(const int16_t *buf_left, const int16_t *buf_right, ssize_t samples, size_t half_height)
+void Visualizer::DrawSoundEllipseStereo(const SampleBuffer::Span &buf_left, const SampleBuffer::Span &buf_right, size_t half_height)
 {
+	const size_t samples = std::min(buf_left.size(), buf_right.size());
 	const size_t width = w.getWidth();
 	const size_t left_half_width = width/2;
 	const size_t right_half_width = width - left_half_width;
@@ -407,7 +452,7 @@ void Visualizer::DrawSoundEllipseStereo(const int16_t *buf_left, const int16_t *
 	// Makes the radius of each ring be approximately 2 cells wide.
 	const int32_t radius = 2*Config.visualizer_colors.size();
 	int32_t x, y;
-	for (ssize_t i = 0; i < samples; ++i)
+	for (size_t i = 0; i < samples; ++i)
 	{
 		x = buf_left[i]/32768.0 * (buf_left[i] < 0 ? left_half_width : right_half_width);
 		y = buf_right[i]/32768.0 * (buf_right[i] < 0 ? top_half_height : bottom_half_height);
@@ -417,63 +462,109 @@ void Visualizer::DrawSoundEllipseStereo(const int16_t *buf_left, const int16_t *
 		// (y-h)+2 = r^2 centers the circle around the point (w,h). Because fonts
 		// are not all the same size, this will not always generate a perfect
 		// circle.
-		auto c = toColor(sqrt(x*x + 4*y*y), radius, true);
-		w << NC::XY(left_half_width + x, top_half_height + y)
-		  << c
-		  << Config.visualizer_chars[1]
-		  << NC::FormattedColor::End<>(c);
+		DrawCell(left_half_width + x, top_half_height + y, Config.visualizer_chars[1],
+		         toColor(sqrt(x*x + 4*y*y), radius, true));
 	}
 }
 
 /**********************************************************************/
 
 #ifdef HAVE_FFTW3_H
-void Visualizer::DrawFrequencySpectrum(const int16_t *buf, ssize_t samples, size_t y_offset, size_t height)
+void Visualizer::DrawFrequencySpectrum(const SampleBuffer::Span &buf, size_t y_offset, size_t height)
 {
 	// If right channel is drawn, bars descend from the top to the bottom.
 	const bool flipped = y_offset > 0;
-
-	// copy samples to fftw input array and apply Hamming window
-	ApplyWindow(m_fftw_input, buf, samples);
-	fftw_execute(m_fftw_plan);
-
-	// Count magnitude of each frequency and normalize
-	for (size_t i = 0; i < m_fftw_results; ++i)
-		m_freq_magnitudes[i] = sqrt(
-			m_fftw_output[i][0]*m_fftw_output[i][0]
-		+	m_fftw_output[i][1]*m_fftw_output[i][1]
-		) / (DFT_NONZERO_SIZE);
-
-	m_bar_heights.clear();
-
 	const size_t win_width = w.getWidth();
 
-	size_t cur_bin = 0;
-	while (cur_bin < m_fftw_results && Bin2Hz(cur_bin) < m_dft_logspace[0])
-		++cur_bin;
+	auto &targets = m_spectrum_targets[flipped];
+	auto &heights = m_spectrum_heights[flipped];
+	if (m_spectrum_transform || targets.size() != win_width)
+		ComputeSpectrum(targets, buf, height);
+	if (heights.size() != win_width)
+		heights.assign(win_width, 0);
+
+	// Move bars towards computed heights, rising with attack and falling with
+	// decay time constant.
+	const double frame_time = 1000.0 / Config.visualizer_fps;
+	auto smoothing = [frame_time](double time_constant) {
+		return time_constant > 0 ? 1 - std::exp(-frame_time / time_constant) : 1;
+	};
+	const double attack = smoothing(Config.visualizer_spectrum_attack);
+	const double decay = smoothing(Config.visualizer_spectrum_decay);
 	for (size_t x = 0; x < win_width; ++x)
 	{
-		double bar_height = 0;
+		const double delta = targets[x] - heights[x];
+		heights[x] += delta * (delta > 0 ? attack : decay);
+	}
 
-		// accumulate bins
-		size_t count = 0;
-		// check right bound
-		while (cur_bin < m_fftw_results && Bin2Hz(cur_bin) < m_dft_logspace[x])
+	for (size_t x = 0; x < win_width; ++x)
+	{
+		const double h = heights[x];
+		for (size_t j = 0; j < h; ++j)
 		{
-			// check left bound if not first index
-			if (x == 0 || Bin2Hz(cur_bin) >= m_dft_logspace[x-1])
-			{
-				bar_height += m_freq_magnitudes[cur_bin];
-				++count;
+			size_t y = flipped ? y_offset+j : y_offset+height-j-1;
+			const auto &color = toColor(j, height, false);
+			bool reverse = false;
+			wchar_t ch;
+
+			// select character to draw
+			if (Config.visualizer_spectrum_smooth_look) {
+				// smooth
+				const size_t size = SMOOTH_CHARS.size();
+				const size_t idx = static_cast<size_t>(size*h) % size;
+				if (j < h-1 || idx == size-1) {
+					// full height
+					ch = SMOOTH_CHARS[size-1];
+				} else {
+					// fractional height
+					if (flipped) {
+						ch = SMOOTH_CHARS[size-idx-2];
+						reverse = true;
+					} else {
+						ch = SMOOTH_CHARS[idx];
+					}
+				}
+			} else  {
+				// default, non-smooth
+				ch = Config.visualizer_chars[1];
 			}
-			++cur_bin;
+
+			DrawCell(x, y, ch, color, reverse);
 		}
+	}
+}
 
-		if (count == 0)
+void Visualizer::ComputeSpectrum(std::vector<double> &targets, const SampleBuffer::Span &buf, size_t height)
+{
+	// copy samples to fftw input array and apply Blackman window
+	ApplyWindow(m_fftw_input, buf);
+	fftwf_execute(m_fftw_plan);
+
+	// Count magnitude of each frequency displayed in any column and normalize
+	const size_t first_bin = m_column_bins.front();
+	const size_t last_bin = m_column_bins.back();
+	const float norm = 1.0f / DFT_NONZERO_SIZE;
+	for (size_t i = first_bin; i < last_bin; ++i)
+	{
+		const float re = m_fftw_output[i][0];
+		const float im = m_fftw_output[i][1];
+		m_freq_magnitudes[i] = std::sqrt(re*re + im*im) * norm;
+	}
+
+	m_bar_heights.clear();
+
+	const size_t win_width = w.getWidth();
+	for (size_t x = 0; x < win_width; ++x)
+	{
+		const size_t begin = m_column_bins[x];
+		const size_t end = m_column_bins[x+1];
+		if (begin == end)
 			continue;
 
 		// average bins
-		bar_height /= count;
+		double bar_height = std::accumulate(
+			m_freq_magnitudes.begin() + begin, m_freq_magnitudes.begin() + end, 0.0);
+		bar_height /= end - begin;
 
 		// log scale bar heights
 		bar_height = (20 * log10(bar_height) + DYNAMIC_RANGE + GAIN) / DYNAMIC_RANGE;
@@ -484,64 +575,39 @@ void Visualizer::DrawFrequencySpectrum(const int16_t *buf, ssize_t samples, size
 		m_bar_heights.emplace_back(x, bar_height);
 	}
 
+	targets.resize(win_width);
 	size_t h_idx = 0;
 	for (size_t x = 0; x < win_width; ++x)
 	{
 		const size_t i = m_bar_heights[h_idx].first;
 		const double bar_height = m_bar_heights[h_idx].second;
-		double h = 0;
 
 		if (x == i) {
 			// this data point exists
-			h = bar_height;
+			targets[x] = bar_height;
 			if (h_idx < m_bar_heights.size()-1)
 				++h_idx;
 		} else {
 			// data point does not exist, need to interpolate
-			h = Interpolate(x, h_idx);
-		}
-
-		for (size_t j = 0; j < h; ++j)
-		{
-			size_t y = flipped ? y_offset+j : y_offset+height-j-1;
-			auto color = toColor(j, height, false);
-			std::wstring ch;
-	
-			// select character to draw
-			if (Config.visualizer_spectrum_smooth_look) {
-				// smooth
-				const size_t size = SMOOTH_CHARS.size();
-				const size_t idx = static_cast<size_t>(size*h) % size;
-				if (j < h-1 || idx == size-1) {
-					// full height
-					ch = SMOOTH_CHARS[size-1];
-				} else {
-					// fractional height
-					if (flipped) {
-						ch = SMOOTH_CHARS[size-idx-2];
-						color = NC::FormattedColor(color.color(), {NC::Format::Reverse});
-					} else {
-						ch = SMOOTH_CHARS[idx];
-					}
-				}
-			} else  {
-				// default, non-smooth
-				ch = Config.visualizer_chars[1];
-			}
-
-			// draw character on screen
-			w << NC::XY(x, y)
-			  << color
-			  << ch
-			  << NC::FormattedColor::End<>(color);
+			targets[x] = Interpolate(x, h_idx);
 		}
 	}
 }
 
-void Visualizer::DrawFrequencySpectrumStereo(const int16_t *buf_left, const int16_t *buf_right, ssize_t samples, size_t height)
+void Visualizer::AdvanceSpectrum(size_t new_samples)
+{
+	// Spectrum is recomputed only once per hop, the window of analyzed samples
+	// overlaps with the previous one by the rest. In between bars keep moving
+	// towards the last computed heights.
+	m_spectrum_pending_samples += new_samples;
+	m_spectrum_transform = m_spectrum_pending_samples >= m_spectrum_hop;
+	m_spectrum_pending_samples %= m_spectrum_hop;
+}
+
+void Visualizer::DrawFrequencySpectrumStereo(const SampleBuffer::Span &buf_left, const SampleBuffer::Span &buf_right, size_t height)
 {
-	DrawFrequencySpectrum(buf_left, samples, 0, height);
-	DrawFrequencySpectrum(buf_right, samples, height, w.getHeight() - height);
+	DrawFrequencySpectrum(buf_left, 0, height);
+	DrawFrequencySpectrum(buf_right, height, w.getHeight() - height);
 }
 
 double Visualizer::Interpolate(size_t x, size_t h_idx)
@@ -589,7 +655,16 @@ double Visualizer::Interpolate(size_t x, size_t h_idx)
 	return h_next;
 }
 
-void Visualizer::ApplyWindow(double *output, const int16_t *input, ssize_t samples)
+void Visualizer::ApplyWindow(float *output, const SampleBuffer::Span &input)
+{
+	assert(input.size() <= m_fft_window.size());
+	for (size_t i = 0; i < input.first_size; ++i)
+		output[i] = m_fft_window[i] * input.first[i];
+	for (size_t i = 0, j = input.first_size; i < input.second_size; ++i, ++j)
+		output[j] = m_fft_window[j] * input.second[i];
+}
+
+void Visualizer::GenWindow()
 {
 	// Use Blackman window for low sidelobes and fast sidelobe rolloff
 	// don't care too much about mainlobe width
@@ -598,16 +673,18 @@ void Visualizer::ApplyWindow(double *output, const int16_t *input, ssize_t sampl
 	const double a1 = 0.5;
 	const double a2 = alpha / 2;
 	const double pi = boost::math::constants::pi<double>();
-	for (unsigned i = 0; i < samples; ++i)
+	m_fft_window.resize(DFT_NONZERO_SIZE);
+	for (size_t i = 0; i < m_fft_window.size(); ++i)
 	{
 		double window = a0 - a1*cos(2*pi*i/(DFT_NONZERO_SIZE-1)) + a2*cos(4*pi*i/(DFT_NONZERO_SIZE-1));
-		output[i] = window * input[i] / INT16_MAX;
+		// fold normalization of samples into the window
+		m_fft_window[i] = window / INT16_MAX;
 	}
 }
 
 double Visualizer::Bin2Hz(size_t bin)
 {
-	return bin*44100/DFT_TOTAL_SIZE;
+	return bin*m_source_format.rate/DFT_TOTAL_SIZE;
 }
 
 // Generate log-scaled vector of frequencies from HZ_MIN to HZ_MAX
@@ -622,9 +699,66 @@ void Visualizer::GenLogspace()
 	for (size_t i = left_bins; i < m_dft_logspace.size() + left_bins; ++i) {
 		m_dft_logspace[i - left_bins] = pow(10, i * log_scale);
 	}
+
+	// Precompute ranges of bins that fall into each column. Column x covers
+	// frequencies between m_dft_logspace[x-1] and m_dft_logspace[x], so the
+	// first column is always empty.
+	m_column_bins.resize(win_width + 1);
+	size_t bin = 0;
+	for (size_t x = 0; x < win_width; ++x)
+	{
+		while (bin < m_fftw_results && Bin2Hz(bin) < m_dft_logspace[x])
+			++bin;
+		if (x == 0)
+			m_column_bins[0] = bin;
+		m_column_bins[x+1] = bin;
+	}
 }
 #endif // HAVE_FFTW3_H
 
+void Visualizer::DrawCell(size_t x, size_t y, wchar_t ch, const NC::FormattedColor &color, bool reverse)
+{
+	if (x < m_frame_width && y < m_frame_height)
+		m_frame[y*m_frame_width + x] = Cell{ch, &color, reverse};
+}
+
+void Visualizer::FlushFrame()
+{
+	for (size_t y = 0; y < m_frame_height; ++y)
+	{
+		for (size_t x = 0; x < m_frame_width; ++x)
+		{
+			const size_t i = y*m_frame_width + x;
+			const Cell &cell = m_frame[i];
+			if (cell == m_displayed_frame[i])
+				continue;
+			w << NC::XY(x, y);
+			if (cell.color == nullptr)
+				w << L' ';
+			else if (cell.reverse)
+			{
+				NC::FormattedColor color(cell.color->color(), {NC::Format::Reverse});
+				w << color << cell.ch << NC::FormattedColor::End<>(color);
+			}
+			else
+				w << *cell.color << cell.ch << NC::FormattedColor::End<>(*cell.color);
+		}
+	}
+	m_displayed_frame.swap(m_frame);
+	std::fill(m_frame.begin(), m_frame.end(), Cell());
+}
+
+void Visualizer::ResetFrame()
+{
+	w.clear();
+	m_frame_width = w.getWidth();
+	m_frame_height = w.getHeight();
+	m_frame.assign(m_frame_width*m_frame_height, Cell());
+	m_displayed_frame.assign(m_frame_width*m_frame_height, Cell());
+}
+
+/**********************************************************************/
+
 void Visualizer::InitDataSource()
 {
 	if (!Config.visualizer_fifo_path.empty())
@@ -642,6 +776,14 @@ void Visualizer::InitDataSource()
 	}
 	else
 		m_source_port.clear();
+
+	// Without explicitly specified format assume the one that was required
+	// before arbitrary formats were supported.
+	if (Config.visualizer_format)
+		m_source_format = *Config.visualizer_format;
+	else
+		m_source_format = PCMFormat(44100, PCMFormat::SampleType::S16,
+		                            Config.visualizer_in_stereo ? 2 : 1);
 }
 
 void Visualizer::InitVisualization()
@@ -651,7 +793,7 @@ void Visualizer::InitVisualization()
 	{
 	case VisualizerType::Wave:
 		// Guarantee integral amount of samples per column.
-		rendered_samples = ceil(44100.0 / Config.visualizer_fps / w.getWidth());
+		rendered_samples = ceil(double(m_source_format.rate) / Config.visualizer_fps / w.getWidth());
 		rendered_samples *= w.getWidth();
 		// Slow the scolling 10 times to make it watchable.
 		rendered_samples *= 10;
@@ -660,7 +802,7 @@ void Visualizer::InitVisualization()
 		break;
 	case VisualizerType::WaveFilled:
 		// Guarantee integral amount of samples per column.
-		rendered_samples = ceil(44100.0 / Config.visualizer_fps / w.getWidth());
+		rendered_samples = ceil(double(m_source_format.rate) / Config.visualizer_fps / w.getWidth());
 		rendered_samples *= w.getWidth();
 		// Slow the scolling 10 times to make it watchable.
 		rendered_samples *= 10;
@@ -676,40 +818,39 @@ void Visualizer::InitVisualization()
 #	endif // HAVE_FFTW3_H
 	case VisualizerType::Ellipse:
 		// Keep constant amount of samples on the screen regardless of fps.
-		rendered_samples = 44100 / 30;
+		rendered_samples = m_source_format.rate / 30;
 		draw = &Visualizer::DrawSoundEllipse;
 		drawStereo = &Visualizer::DrawSoundEllipseStereo;
 		break;
 	}
 	if (Config.visualizer_in_stereo)
 		rendered_samples *= 2;
-	m_rendered_samples.resize(rendered_samples);
 
 	// Keep 500ms worth of samples in the incoming buffer.
-	size_t buffered_samples = 44100.0 / 2;
+	size_t buffered_samples = m_source_format.rate / 2;
 	if (Config.visualizer_in_stereo)
 		buffered_samples *= 2;
 	m_incoming_samples.resize(buffered_samples);
-	m_buffered_samples.resize(buffered_samples);
+	m_buffered_samples.resize(buffered_samples, rendered_samples);
+
+	ResetFrame();
 }
 
 /**********************************************************************/
 
 void Visualizer::Clear()
 {
-	w.clear();
-	std::fill(m_rendered_samples.begin(), m_rendered_samples.end(), 0);
-
-	// Discard any lingering data from the data source.
-	if (m_source_fd >= 0)
-	{
-		ssize_t bytes_read;
-		do
-			bytes_read = read(m_source_fd, m_incoming_samples.data(),
-			                  sizeof(int16_t) * m_incoming_samples.size());
-		while (bytes_read > 0);
-	}
+	ResetFrame();
+	m_next_frame = FrameClock::now();
+#	ifdef HAVE_FFTW3_H
+	for (auto &heights : m_spectrum_heights)
+		heights.clear();
+#	endif // HAVE_FFTW3_H
 
+	// Discard any lingering data from the data source along with the samples
+	// that were rendered.
+	m_captured_samples.clear();
+	m_buffered_samples.clear();
 }
 
 void Visualizer::ToggleVisualizationType()
@@ -792,15 +933,77 @@ void Visualizer::OpenDataSource()
 			Statusbar::printf("Couldn't open \"%1%\" for reading PCM data: %2%",
 			                  m_source_location, strerror(errno));
 	}
+
+	if (m_source_fd >= 0)
+		StartCapture();
 }
 
 void Visualizer::CloseDataSource()
 {
+	StopCapture();
 	if (m_source_fd >= 0)
 		close(m_source_fd);
 	m_source_fd = -1;
 }
 
+void Visualizer::StartCapture()
+{
+	assert(!m_capture_thread.joinable());
+	m_captured_samples.clear();
+	m_capture_stopped = false;
+	m_capture_thread = std::thread(
+		&Visualizer::CaptureSamples, this,
+		m_source_fd, m_source_format, Config.visualizer_in_stereo ? 2 : 1);
+}
+
+void Visualizer::StopCapture()
+{
+	if (m_capture_thread.joinable())
+	{
+		m_capture_stopped = true;
+		m_capture_thread.join();
+	}
+}
+
+void Visualizer::CaptureSamples(int fd, PCMFormat format, size_t channels)
+{
+	// Only whole frames (samples of all channels) are passed on, so that the
+	// channels don't get swapped if a read ends in the middle of one.
+	const size_t frame_size = format.frameSize();
+	// int32_t ensures alignment suitable for all sample types.
+	std::vector<int32_t> buffer(4096 * format.channels);
+	char *data = reinterpret_cast<char *>(buffer.data());
+	const size_t buffer_size = sizeof(int32_t) * buffer.size();
+	std::vector<int16_t> converted(buffer_size / frame_size * channels);
+	size_t pending = 0;
+
+	pollfd pfd = { fd, POLLIN, 0 };
+	while (!m_capture_stopped)
+	{
+		// Check whether capture was stopped every 100ms.
+		if (poll(&pfd, 1, 100) <= 0)
+			continue;
+		ssize_t bytes_read = read(fd, data + pending, buffer_size - pending);
+		if (bytes_read == 0)
+		{
+			// There is no writer on the other end of the FIFO, poll would return
+			// immediately.
+			std::this_thread::sleep_for(std::chrono::milliseconds(100));
+			continue;
+		}
+		else if (bytes_read < 0)
+			continue;
+		pending += bytes_read;
+		size_t frames = pending / frame_size;
+		size_t complete = frames * frame_size;
+		pcmConvert(data, frames, format, converted.data(), channels);
+		// If the main thread doesn't keep up, newest samples are dropped.
+		m_captured_samples.write(converted.data(), frames * channels);
+		std::memmove(data, data + complete, pending - complete);
+		pending -= complete;
+	}
+}
+
 void Visualizer::FindOutputID()
 {
 	m_output_id = -1;
@@ -826,4 +1029,134 @@ void Visualizer::ResetAutoScaleMultiplier()
 	m_auto_scale_multiplier = 1;
 }
 
+/**********************************************************************/
+
+void Visualizer::Benchmark()
+{
+	const std::vector<std::pair<size_t, size_t>> sizes = {
+		{ 80, 24 }, { 160, 48 }, { 320, 96 }
+	};
+	const std::vector<size_t> fps_values = { 30, 60, 144 };
+	const std::vector<VisualizerType> types = {
+		VisualizerType::Wave,
+		VisualizerType::WaveFilled,
+#	ifdef HAVE_FFTW3_H
+		VisualizerType::Spectrum,
+#	endif // HAVE_FFTW3_H
+		VisualizerType::Ellipse,
+	};
+	const size_t frames = 200;
+	const size_t rate = 44100;
+
+	// Rendering is done into a curses screen that outputs to /dev/null, large
+	// enough to hold the biggest of the windows.
+	int stdout_fd = dup(STDOUT_FILENO);
+	int null_fd = open("/dev/null", O_WRONLY);
+	if (stdout_fd < 0 || null_fd < 0)
+		throw std::runtime_error("couldn't redirect standard output: " + std::string(strerror(errno)));
+	setenv("COLUMNS", std::to_string(sizes.back().first).c_str(), 1);
+	setenv("LINES", std::to_string(sizes.back().second).c_str(), 1);
+	fflush(stdout);
+	dup2(null_fd, STDOUT_FILENO);
+	close(null_fd);
+	NC::initScreen(Config.colors_enabled, false);
+	Global::MainStartY = 0;
+	Global::MainHeight = LINES;
+
+	// Two seconds of a logarithmic sine sweep from 20Hz to 20kHz, white noise
+	// and silence.
+	auto generate = [rate](size_t channels, const std::string &signal) {
+		std::vector<int16_t> samples(2 * rate * channels);
+		std::mt19937 gen(0);
+		std::uniform_int_distribution<int> noise(std::numeric_limits<int16_t>::min(),
+		                                         std::numeric_limits<int16_t>::max());
+		const double pi = boost::math::constants::pi<double>();
+		const double duration = 2.0, f0 = 20, f1 = 20000;
+		const double k = std::log(f1/f0);
+		for (size_t i = 0; i < samples.size() / channels; ++i)
+		{
+			int16_t value = 0;
+			if (signal == "sweep")
+			{
+				double t = double(i) / rate;
+				double phase = 2*pi*f0*duration/k * (std::exp(t/duration*k) - 1);
+				value = 0.8 * std::numeric_limits<int16_t>::max() * std::sin(phase);
+			}
+			else if (signal == "noise")
+				value = noise(gen);
+			for (size_t c = 0; c < channels; ++c)
+				samples[i*channels + c] = value;
+		}
+		return samples;
+	};
+
+	std::ostringstream results;
+	Visualizer v;
+	for (const auto &size : sizes)
+	{
+		v.w.resize(size.first, size.second);
+		for (auto fps : fps_values)
+		{
+			Config.visualizer_fps = fps;
+			for (auto type : types)
+			{
+				Config.visualizer_type = type;
+				for (bool stereo : { false, true })
+				{
+					const size_t channels = stereo ? 2 : 1;
+					Config.visualizer_in_stereo = stereo;
+					v.m_source_format = PCMFormat(rate, PCMFormat::SampleType::S16, channels);
+					v.InitVisualization();
+#					ifdef HAVE_FFTW3_H
+					v.GenLogspace();
+#					endif // HAVE_FFTW3_H
+					for (const std::string signal : { "sweep", "noise", "silence" })
+					{
+						auto samples = generate(channels, signal);
+						const size_t hop = rate / fps * channels;
+						size_t offset = 0;
+						// Slide over the signal, wrapping around at its end.
+						auto feed = [&](size_t n) {
+							while (n > 0)
+							{
+								size_t part = std::min(n, samples.size() - offset);
+								v.m_buffered_samples.put(samples.data() + offset, part);
+								v.m_buffered_samples.consume(part);
+								offset = (offset + part) % samples.size();
+								n -= part;
+							}
+						};
+						// Fill the whole window before the first frame.
+						feed(v.m_buffered_samples.window().size());
+						FrameClock::duration total(0);
+						for (size_t i = 0; i < frames; ++i)
+						{
+							feed(hop);
+							auto start = FrameClock::now();
+#							ifdef HAVE_FFTW3_H
+							v.AdvanceSpectrum(hop / channels);
+#							endif // HAVE_FFTW3_H
+							v.Render();
+							total += FrameClock::now() - start;
+						}
+						results << boost::format("%1$-11s %2$-6s %3$3dx%4$-3d %5$3d fps %6$-7s : %7$9d ns/frame\n")
+							% type
+							% (stereo ? "stereo" : "mono")
+							% size.first % size.second
+							% fps
+							% signal
+							% (std::chrono::duration_cast<std::chrono::nanoseconds>(total).count() / frames);
+					}
+				}
+			}
+		}
+	}
+
+	NC::destroyScreen();
+	fflush(stdout);
+	dup2(stdout_fd, STDOUT_FILENO);
+	close(stdout_fd);
+	std::cout << results.str();
+}
+
 #endif // ENABLE_VISUALIZER
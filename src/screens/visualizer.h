@@ -25,11 +25,17 @@
 
 #ifdef ENABLE_VISUALIZER
 
+#include <atomic>
 #include <boost/date_time/posix_time/posix_time_types.hpp>
+#include <chrono>
+#include <thread>
+#include "curses/formatted_color.h"
 #include "curses/window.h"
 #include "interfaces.h"
 #include "screens/screen.h"
+#include "utility/pcm.h"
 #include "utility/sample_buffer.h"
+#include "utility/spsc_ring_buffer.h"
 
 #ifdef HAVE_FFTW3_H
 # include <fftw3.h>
@@ -64,48 +70,107 @@ struct Visualizer: Screen<NC::Window>, Tabbable
 	void FindOutputID();
 	void ResetAutoScaleMultiplier();
 
+	// Measures time needed to render a frame with each visualization type for
+	// various window sizes, frame rates and synthetic signals and prints the
+	// results to standard output.
+	static void Benchmark();
+
 private:
-	void DrawSoundWave(const int16_t *, ssize_t, size_t, size_t);
-	void DrawSoundWaveStereo(const int16_t *, const int16_t *, ssize_t, size_t);
-	void DrawSoundWaveFill(const int16_t *, ssize_t, size_t, size_t);
-	void DrawSoundWaveFillStereo(const int16_t *, const int16_t *, ssize_t, size_t);
-	void DrawSoundEllipse(const int16_t *, ssize_t, size_t, size_t);
-	void DrawSoundEllipseStereo(const int16_t *, const int16_t *, ssize_t, size_t);
+	void DrawSoundWave(const SampleBuffer::Span &, size_t, size_t);
+	void DrawSoundWaveStereo(const SampleBuffer::Span &, const SampleBuffer::Span &, size_t);
+	void DrawSoundWaveFill(const SampleBuffer::Span &, size_t, size_t);
+	void DrawSoundWaveFillStereo(const SampleBuffer::Span &, const SampleBuffer::Span &, size_t);
+	void DrawSoundEllipse(const SampleBuffer::Span &, size_t, size_t);
+	void DrawSoundEllipseStereo(const SampleBuffer::Span &, const SampleBuffer::Span &, size_t);
 #	ifdef HAVE_FFTW3_H
-	void DrawFrequencySpectrum(const int16_t *, ssize_t, size_t, size_t);
-	void DrawFrequencySpectrumStereo(const int16_t *, const int16_t *, ssize_t, size_t);
-	void ApplyWindow(double *, const int16_t *, ssize_t);
+	void DrawFrequencySpectrum(const SampleBuffer::Span &, size_t, size_t);
+	void DrawFrequencySpectrumStereo(const SampleBuffer::Span &, const SampleBuffer::Span &, size_t);
+	void ComputeSpectrum(std::vector<double> &, const SampleBuffer::Span &, size_t);
+	void AdvanceSpectrum(size_t);
+	void ApplyWindow(float *, const SampleBuffer::Span &);
+	void GenWindow();
 	void GenLogspace();
 	double Bin2Hz(size_t);
 	double Interpolate(size_t, size_t);
 #	endif // HAVE_FFTW3_H
 
+	typedef std::chrono::steady_clock FrameClock;
+	FrameClock::duration FramePeriod() const;
+	void UpdateStatistics(FrameClock::time_point now);
+
+	void Render();
+
+	void DrawCell(size_t x, size_t y, wchar_t ch, const NC::FormattedColor &color, bool reverse = false);
+	void FlushFrame();
+	void ResetFrame();
+
 	void InitDataSource();
 	void InitVisualization();
 
-	void (Visualizer::*draw)(const int16_t *, ssize_t, size_t, size_t);
-	void (Visualizer::*drawStereo)(const int16_t *, const int16_t *, ssize_t, size_t);
+	void StartCapture();
+	void StopCapture();
+	void CaptureSamples(int fd, PCMFormat format, size_t channels);
+
+	void (Visualizer::*draw)(const SampleBuffer::Span &, size_t, size_t);
+	void (Visualizer::*drawStereo)(const SampleBuffer::Span &, const SampleBuffer::Span &, size_t);
 
 	int m_output_id;
 	bool m_reset_output;
 
+	FrameClock::time_point m_next_frame;
+
+	// Achieved frame rate and average render time are measured over one
+	// second long periods and displayed in the title.
+	FrameClock::time_point m_stats_start;
+	size_t m_stats_frames;
+	FrameClock::duration m_stats_render_time;
+	double m_achieved_fps;
+	double m_render_time_ms;
+
 	int m_source_fd;
 	std::string m_source_location;
 	std::string m_source_port;
-
-	std::vector<int16_t> m_rendered_samples;
+	PCMFormat m_source_format;
+
+	// Samples are read from the data source by a separate thread so that none
+	// of them are lost when the main thread is busy.
+	std::thread m_capture_thread;
+	std::atomic<bool> m_capture_stopped;
+	SPSCRingBuffer<int16_t> m_captured_samples;
+
+	// Draw routines put cells into m_frame, then only the ones that differ
+	// from m_displayed_frame are written to the window.
+	struct Cell
+	{
+		Cell() : ch(0), color(nullptr), reverse(false) { }
+		Cell(wchar_t ch_, const NC::FormattedColor *color_, bool reverse_)
+			: ch(ch_), color(color_), reverse(reverse_) { }
+
+		bool operator==(const Cell &rhs) const
+		{
+			return ch == rhs.ch && color == rhs.color && reverse == rhs.reverse;
+		}
+
+		wchar_t ch;
+		const NC::FormattedColor *color;
+		bool reverse;
+	};
+	std::vector<Cell> m_frame;
+	std::vector<Cell> m_displayed_frame;
+	size_t m_frame_width;
+	size_t m_frame_height;
+
+	std::vector<int16_t> m_left_samples;
+	std::vector<int16_t> m_right_samples;
 	std::vector<int16_t> m_incoming_samples;
 	SampleBuffer m_buffered_samples;
-	size_t m_sample_consumption_rate;
-	size_t m_sample_consumption_rate_up_ctr;
-	size_t m_sample_consumption_rate_dn_ctr;
 
 	double m_auto_scale_multiplier;
 #	ifdef HAVE_FFTW3_H
 	size_t m_fftw_results;
-	double *m_fftw_input;
-	fftw_complex *m_fftw_output;
-	fftw_plan m_fftw_plan;
+	float *m_fftw_input;
+	fftwf_complex *m_fftw_output;
+	fftwf_plan m_fftw_plan;
 	const uint32_t DFT_NONZERO_SIZE;
 	const uint32_t DFT_TOTAL_SIZE;
 	const double DYNAMIC_RANGE;
@@ -113,10 +178,22 @@ private:
 	const double HZ_MAX;
 	const double GAIN;
 	const std::wstring SMOOTH_CHARS;
+	std::vector<float> m_fft_window;
 	std::vector<double> m_dft_logspace;
+	// Bins in range [m_column_bins[x], m_column_bins[x+1]) are displayed in
+	// column x.
+	std::vector<size_t> m_column_bins;
 	std::vector<std::pair<size_t, double>> m_bar_heights;
 
-	std::vector<double> m_freq_magnitudes;
+	size_t m_spectrum_hop;
+	size_t m_spectrum_pending_samples;
+	bool m_spectrum_transform;
+	// Heights of bars computed from the last transform and the displayed ones
+	// that approach them, for each channel.
+	std::vector<double> m_spectrum_targets[2];
+	std::vector<double> m_spectrum_heights[2];
+
+	std::vector<float> m_freq_magnitudes;
 #	endif // HAVE_FFTW3_H
 };
 
@@ -18,6 +18,7 @@
  *   51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.              *
  ***************************************************************************/
 
+#include <boost/algorithm/string/predicate.hpp>
 #include <boost/tuple/tuple.hpp>
 #include <boost/tokenizer.hpp>
 #include <fstream>
@@ -81,6 +82,14 @@ std::vector<Column> generate_columns(const std::string &format)
 				col.type += tag_type[(++i)++]; // nice one.
 			while (tag_type[i] == '|');
 
+			for (const auto &type : col.type)
+			{
+				auto f = charToGetFunction(type);
+				if (f == nullptr)
+					throw std::runtime_error("invalid column type: " + std::string(1, type));
+				col.get_functions.push_back(f);
+			}
+
 			// apply attributes
 			for (; i < tag_type.length(); ++i)
 			{
@@ -130,12 +139,8 @@ Format::AST<char> columns_to_format(const std::vector<Column> &columns)
 	while (true)
 	{
 		Format::FirstOf<char> first_of;
-		for (const auto &type : column->type)
-		{
-			auto f = charToGetFunction(type);
-			assert(f != nullptr);
+		for (const auto &f : column->get_functions)
 			first_of.base().push_back(f);
-		}
 		result.push_back(std::move(first_of));
 
 		if (++column != columns.end())
@@ -233,6 +238,16 @@ bool Configuration::read(const std::vector<std::string> &config_paths, bool igno
 	p.add("visualizer_data_source", &visualizer_data_source, "/tmp/mpd.fifo", adjust_path);
 	p.add("visualizer_output_name", &visualizer_output_name, "Visualizer feed");
 	p.add("visualizer_in_stereo", &visualizer_in_stereo, "yes", yes_no);
+	p.add("visualizer_format", &visualizer_format, "", [](std::string v) {
+			boost::optional<PCMFormat> format;
+			if (!v.empty())
+			{
+				format = parsePCMFormat(v);
+				if (!format)
+					invalid_value(v);
+			}
+			return format;
+		});
 	p.add("visualizer_type", &visualizer_type,
 #ifdef HAVE_FFTW3_H
 	      "spectrum"
@@ -252,6 +267,7 @@ bool Configuration::read(const std::vector<std::string> &config_paths, bool igno
 			return result;
 			});
 	p.add("visualizer_autoscale", &visualizer_autoscale, "no", yes_no);
+	p.add("visualizer_show_statistics", &visualizer_show_statistics, "no", yes_no);
 	p.add("visualizer_spectrum_smooth_look", &visualizer_spectrum_smooth_look, "yes", yes_no);
 	p.add("visualizer_spectrum_dft_size", &visualizer_spectrum_dft_size,
 			"2", [](std::string v) {
@@ -277,18 +293,35 @@ bool Configuration::read(const std::vector<std::string> &config_paths, bool igno
 			lowerBoundCheck<double>(result, Config.visualizer_spectrum_hz_min+1);
 			return result;
 			});
+	p.add("visualizer_spectrum_overlap", &visualizer_spectrum_overlap,
+			"95", [](std::string v) {
+			auto result = verbose_lexical_cast<size_t>(v);
+			boundsCheck<size_t>(result, 0, 99);
+			return result;
+			});
+	p.add("visualizer_spectrum_attack", &visualizer_spectrum_attack,
+			"0", [](std::string v) {
+			auto result = verbose_lexical_cast<double>(v);
+			lowerBoundCheck<double>(result, 0);
+			return result;
+			});
+	p.add("visualizer_spectrum_decay", &visualizer_spectrum_decay,
+			"0", [](std::string v) {
+			auto result = verbose_lexical_cast<double>(v);
+			lowerBoundCheck<double>(result, 0);
+			return result;
+			});
 	p.add("visualizer_color", &visualizer_colors,
 	      "blue, cyan, green, yellow, magenta, red", list_of<NC::FormattedColor>);
 	p.add("system_encoding", &system_encoding, "", [](std::string encoding) {
 #ifdef HAVE_LANGINFO_H
 			// try to autodetect system encoding
 			if (encoding.empty())
-			{
 				encoding = nl_langinfo(CODESET);
-				if (encoding == "UTF-8") // mpd uses utf-8 by default so no need to convert
-					encoding.clear();
-			}
 #endif // HAVE_LANGINFO_H
+			// mpd uses utf-8 by default so no need to convert
+			if (boost::iequals(encoding, "UTF-8") || boost::iequals(encoding, "UTF8"))
+				encoding.clear();
 			return encoding;
 		});
 	p.add("playlist_disable_highlight_delay", &playlist_disable_highlight_delay,
@@ -387,11 +420,16 @@ bool Configuration::read(const std::vector<std::string> &config_paths, bool igno
 	      "(20)[]{a} (6f)[green]{NE} (50)[white]{t|f:Title} (20)[cyan]{b} (7f)[magenta]{l}",
 	      [this](std::string v) {
 		      columns = generate_columns(v);
+		      ++columns_generation;
 		      return columns_to_format(columns);
 	      });
 	p.add("execute_on_song_change", &execute_on_song_change, "", adjust_path);
 	p.add("execute_on_player_state_change", &execute_on_player_state_change,
 	      "", adjust_path);
+	p.add("execute_on_change_timeout", &execute_on_change_timeout,
+	      "30", [](std::string v) {
+		      return boost::posix_time::seconds(verbose_lexical_cast<unsigned>(v));
+	      });
 	p.add("playlist_show_mpd_host", &playlist_show_mpd_host, "no", yes_no);
 	p.add("playlist_show_remaining_time", &playlist_show_remaining_time, "no", yes_no);
 	p.add("playlist_shorten_total_times", &playlist_shorten_total_times, "no", yes_no);
@@ -464,12 +502,19 @@ bool Configuration::read(const std::vector<std::string> &config_paths, bool igno
 	p.add("follow_now_playing_lyrics", &now_playing_lyrics, "no", yes_no);
 	p.add("fetch_lyrics_for_current_song_in_background", &fetch_lyrics_in_background,
 	      "no", yes_no);
+	p.add("fetch_lyrics_in_parallel", &fetch_lyrics_in_parallel, "no", yes_no);
+	p.add("lyrics_prefetch", &lyrics_prefetch, "0");
 	p.add("store_lyrics_in_song_dir", &store_lyrics_in_song_dir, "no", yes_no);
+	p.add("store_lyrics_in_single_file", &store_lyrics_in_single_file, "no", yes_no);
 	p.add("generate_win32_compatible_filenames", &generate_win32_compatible_filenames,
 	      "yes", yes_no);
 	p.add("allow_for_physical_item_deletion", &allow_for_physical_item_deletion,
 	      "no", yes_no);
 	p.add("lastfm_preferred_language", &lastfm_preferred_language, "en");
+	p.add("lastfm_cache_ttl", &lastfm_cache_ttl,
+	      "168", [](std::string v) {
+		      return boost::posix_time::hours(verbose_lexical_cast<unsigned>(v));
+	      });
 	p.add("space_add_mode", &space_add_mode, "add_remove");
 	p.add("show_hidden_files_in_local_browser", &local_browser_show_hidden_files,
 	      "no", yes_no);
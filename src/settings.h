@@ -34,6 +34,7 @@
 #include "format.h"
 #include "lyrics_fetcher.h"
 #include "screens/screen_type.h"
+#include "utility/pcm.h"
 
 struct Column
 {
@@ -41,6 +42,8 @@ struct Column
 
 	std::wstring name;
 	std::string type;
+	// functions corresponding to characters in type, resolved during parsing
+	std::vector<MPD::Song::GetFunction> get_functions;
 	int width;
 	int stretch_limit;
 	NC::Color color;
@@ -52,7 +55,9 @@ struct Column
 struct Configuration
 {
 	Configuration()
-	: playlist_disable_highlight_delay(0)
+	: columns_generation(0)
+	, playlist_disable_highlight_delay(0)
+	, execute_on_change_timeout(0)
 	{ }
 
 	bool read(const std::vector<std::string> &config_paths, bool ignore_errors);
@@ -64,6 +69,7 @@ struct Configuration
 	std::string visualizer_fifo_path; // deprecated
 	std::string visualizer_data_source;
 	std::string visualizer_output_name;
+	boost::optional<PCMFormat> visualizer_format;
 	std::string empty_tag;
 
 	Format::AST<char> song_list_format;
@@ -85,11 +91,15 @@ struct Configuration
 	std::wstring visualizer_chars;
 	size_t visualizer_fps;
 	bool visualizer_autoscale;
+	bool visualizer_show_statistics;
 	bool visualizer_spectrum_smooth_look;
 	uint32_t visualizer_spectrum_dft_size;
 	double visualizer_spectrum_gain;
 	double visualizer_spectrum_hz_min;
 	double visualizer_spectrum_hz_max;
+	size_t visualizer_spectrum_overlap;
+	double visualizer_spectrum_attack;
+	double visualizer_spectrum_decay;
 
 	std::string pattern;
 
@@ -98,6 +108,8 @@ struct Configuration
 	std::vector<size_t> media_library_column_width_ratio_three;
 
 	std::vector<Column> columns;
+	// incremented each time columns are regenerated
+	size_t columns_generation;
 
 	DisplayMode playlist_display_mode;
 	DisplayMode browser_display_mode;
@@ -161,6 +173,8 @@ struct Configuration
 	bool incremental_seeking;
 	bool now_playing_lyrics;
 	bool fetch_lyrics_in_background;
+	bool fetch_lyrics_in_parallel;
+	size_t lyrics_prefetch;
 	bool local_browser_show_hidden_files;
 	bool search_in_db;
 	bool jump_to_now_playing_song_at_start;
@@ -184,6 +198,7 @@ struct Configuration
 	bool tag_editor_extended_numeration;
 	bool discard_colors_if_item_is_selected;
 	bool store_lyrics_in_song_dir;
+	bool store_lyrics_in_single_file;
 	bool generate_win32_compatible_filenames;
 	bool ask_for_locked_screen_width_part;
 	bool allow_for_physical_item_deletion;
@@ -202,6 +217,8 @@ struct Configuration
 	boost::regex::flag_type regex_type;
 
 	boost::posix_time::seconds playlist_disable_highlight_delay;
+	boost::posix_time::seconds execute_on_change_timeout;
+	boost::posix_time::time_duration lastfm_cache_ttl;
 
 	double locked_screen_width_part;
 
@@ -19,6 +19,7 @@
  ***************************************************************************/
 
 #include <boost/date_time/posix_time/posix_time.hpp>
+#include <chrono>
 #include <netinet/tcp.h>
 #include <netinet/in.h>
 
@@ -28,6 +29,7 @@
 #include "format_impl.h"
 #include "global.h"
 #include "helpers.h"
+#include "hooks.h"
 #include "macro_utilities.h"
 #include "screens/lyrics.h"
 #include "screens/media_library.h"
@@ -71,6 +73,7 @@ char m_single;
 
 int m_current_song_id;
 int m_current_song_pos;
+int m_next_song_pos;
 unsigned m_elapsed_time;
 unsigned m_kbps;
 MPD::PlayerState m_player_state;
@@ -79,6 +82,37 @@ unsigned m_playlist_length;
 unsigned m_total_time;
 int m_volume;
 
+// Elapsed time of the current song is interpolated locally between status
+// updates, so we need to know the last reported position and when we got it.
+unsigned m_elapsed_time_ms;
+std::chrono::steady_clock::time_point m_elapsed_time_sync;
+
+// If bitrate isn't displayed, status is polled only this often to correct
+// possible drift of the interpolated elapsed time. Seeking, pausing etc. are
+// reported by MPD via idle events, so they don't need polling.
+const std::chrono::seconds elapsed_time_resync_period(30);
+
+void syncElapsedTime(const MPD::Status &st)
+{
+	m_elapsed_time = st.elapsedTime();
+	m_elapsed_time_ms = st.elapsedTimeMs();
+	m_elapsed_time_sync = std::chrono::steady_clock::now();
+	m_kbps = st.kbps();
+}
+
+unsigned interpolatedElapsedTimeMs()
+{
+	unsigned result = m_elapsed_time_ms;
+	if (m_player_state == MPD::psPlay)
+	{
+		auto delta = std::chrono::steady_clock::now() - m_elapsed_time_sync;
+		result += std::chrono::duration_cast<std::chrono::milliseconds>(delta).count();
+		if (m_total_time)
+			result = std::min(result, m_total_time*1000);
+	}
+	return result;
+}
+
 void drawTitle(const MPD::Song &np)
 {
 	assert(!np.empty());
@@ -230,13 +264,30 @@ void Status::trace(bool update_timer, bool update_window_timeout)
 		if (!m_status_initialized)
 			initialize_status();
 
-		if (m_player_state == MPD::psPlay
-		&&  Global::Timer - past > boost::posix_time::seconds(1))
+		if (m_player_state == MPD::psPlay)
 		{
-			// update elapsed time/bitrate of the current song
-			Status::Changes::elapsedTime(true);
-			wFooter->refresh();
-			past = Timer;
+			// Bitrate can't be interpolated, so if it's displayed we need to poll
+			// MPD for it. Otherwise we only resynchronize elapsed time occasionally.
+			bool resync = Config.display_bitrate
+				? Global::Timer - past > boost::posix_time::seconds(1)
+				: std::chrono::steady_clock::now() - m_elapsed_time_sync > elapsed_time_resync_period;
+			if (resync)
+			{
+				// update elapsed time/bitrate of the current song
+				Status::Changes::elapsedTime(true);
+				wFooter->refresh();
+				past = Timer;
+			}
+			else
+			{
+				unsigned elapsed_time = interpolatedElapsedTimeMs() / 1000;
+				if (elapsed_time != m_elapsed_time)
+				{
+					m_elapsed_time = elapsed_time;
+					Status::Changes::elapsedTime(false);
+					wFooter->refresh();
+				}
+			}
 		}
 
 		applyToVisibleWindows(&BaseScreen::update);
@@ -252,6 +303,10 @@ void Status::trace(bool update_timer, bool update_window_timeout)
 		applyToVisibleWindows([&nc_wtimeout](BaseScreen *s) {
 			nc_wtimeout = std::min(nc_wtimeout, s->windowTimeout());
 		});
+		// wake up when the next second of the current song starts, so that
+		// interpolated elapsed time is displayed in sync with the playback.
+		if (Mpd.Connected() && m_player_state == MPD::psPlay)
+			nc_wtimeout = std::min(nc_wtimeout, int(1000 - interpolatedElapsedTimeMs() % 1000));
 		wFooter->setTimeout(nc_wtimeout);
 	}
 }
@@ -260,8 +315,8 @@ void Status::update(int event)
 {
 	auto st = Mpd.getStatus();
 	m_current_song_pos = st.currentSongPosition();
-	m_elapsed_time = st.elapsedTime();
-	m_kbps = st.kbps();
+	m_next_song_pos = st.nextSongPosition();
+	syncElapsedTime(st);
 	m_player_state = st.playerState();
 	m_playlist_length = st.playlistLength();
 	m_total_time = st.totalTime();
@@ -354,6 +409,9 @@ void Status::clear()
 	m_db_updating = 0;
 	m_current_song_id = -1;
 	m_current_song_pos = -1;
+	m_next_song_pos = -1;
+	m_elapsed_time = 0;
+	m_elapsed_time_ms = 0;
 	m_kbps = 0;
 	m_player_state = MPD::psUnknown;
 	m_playlist_length = 0;
@@ -399,6 +457,11 @@ int Status::State::currentSongPosition()
 	return m_current_song_pos;
 }
 
+int Status::State::nextSongPosition()
+{
+	return m_next_song_pos;
+}
+
 unsigned Status::State::playlistLength()
 {
 	return m_playlist_length;
@@ -439,12 +502,14 @@ void Status::Changes::playlist(unsigned previous_version)
 				myPlaylist->unregisterSong(it->value());
 			myPlaylist->main().resizeList(m_playlist_length);
 		}
+		myPlaylist->truncateSongDurations(m_playlist_length);
 
 		MPD::SongIterator s = Mpd.GetPlaylistChanges(previous_version), end;
 		for (; s != end; ++s)
 		{
 			size_t pos = s->getPosition();
 			myPlaylist->registerSong(*s);
+			myPlaylist->setSongDuration(pos, s->getDuration());
 			if (pos < myPlaylist->main().size())
 			{
 				// if song's already in playlist, replace it with a new one
@@ -505,10 +570,8 @@ void Status::Changes::playerState()
 			}
 			throw std::logic_error("unreachable");
 		};
-		setenv("MPD_PLAYER_STATE", stateToEnv(m_player_state), 1);
-		// Since we're setting a MPD_PLAYER_STATE, we need to block.
-		runExternalCommand(Config.execute_on_player_state_change, true);
-		unsetenv("MPD_PLAYER_STATE");
+		Hooks::run(Hooks::Type::PlayerStateChange, Config.execute_on_player_state_change,
+		           {{"MPD_PLAYER_STATE", stateToEnv(m_player_state)}});
 	}
 
 	switch (m_player_state)
@@ -584,15 +647,15 @@ void Status::Changes::songID(int song_id)
 		const auto &s = it != pl.endV() ? *it : Mpd.GetCurrentSong();
 		if (!s.empty())
 		{
+			// The command inherits the terminal, so it can still send output
+			// to it to e.g. set the album art.
 			if (!Config.execute_on_song_change.empty())
-			{
-				// We need to block to allow sending output to the terminal so a script
-				// can e.g. set the album art.
-				runExternalCommand(Config.execute_on_song_change, true);
-			}
+				Hooks::run(Hooks::Type::SongChange, Config.execute_on_song_change);
 
 			if (Config.fetch_lyrics_in_background)
 				myLyrics->fetchInBackground(s, false);
+			if (Config.lyrics_prefetch > 0)
+				myLyrics->prefetch(myPlaylist->upcomingSongs(Config.lyrics_prefetch));
 
 			drawTitle(s);
 
@@ -623,11 +686,7 @@ void Status::Changes::elapsedTime(bool update_elapsed)
 	}
 
 	if (update_elapsed)
-	{
-		auto st = Mpd.getStatus();
-		m_elapsed_time = st.elapsedTime();
-		m_kbps = st.kbps();
-	}
+		syncElapsedTime(Mpd.getStatus());
 
 	std::string ps = playerStateToString(m_player_state);
 	std::string tracklength;
@@ -18,6 +18,8 @@
  *   51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.              *
  ***************************************************************************/
 
+#include <chrono>
+
 #include "global.h"
 #include "settings.h"
 #include "status.h"
@@ -32,8 +34,9 @@ namespace {
 
 bool progressbar_block_update = false;
 
-boost::posix_time::ptime statusbar_lock_time;
-boost::posix_time::seconds statusbar_lock_delay(-1);
+bool statusbar_message_shown = false;
+bool statusbar_message_expired = false;
+NC::EventLoop::TimerID statusbar_message_timer = 0;
 
 bool statusbar_block_update = false;
 bool statusbar_allow_unlock = true;
@@ -96,7 +99,7 @@ Statusbar::ScopedLock::~ScopedLock() noexcept
 {
 	// unlock
 	statusbar_allow_unlock = true;
-	if (statusbar_lock_delay.is_negative())
+	if (!statusbar_message_shown)
 	{
 		if (Config.statusbar_visibility)
 			statusbar_block_update = false;
@@ -125,11 +128,10 @@ bool Statusbar::isUnlocked()
 
 void Statusbar::tryRedraw()
 {
-	using Global::Timer;
-	if (statusbar_lock_delay > boost::posix_time::seconds(0)
-	&&  Timer - statusbar_lock_time > statusbar_lock_delay)
+	if (statusbar_message_expired)
 	{
-		statusbar_lock_delay = boost::posix_time::seconds(-1);
+		statusbar_message_shown = false;
+		statusbar_message_expired = false;
 		
 		if (Config.statusbar_visibility)
 			statusbar_block_update = !statusbar_allow_unlock;
@@ -174,8 +176,13 @@ void Statusbar::print(int delay, const std::string &message)
 	{
         if(delay)
         {
-            statusbar_lock_time = Global::Timer;
-            statusbar_lock_delay = boost::posix_time::seconds(delay);
+            auto &loop = wFooter->eventLoop();
+            loop.cancelTimer(statusbar_message_timer);
+            statusbar_message_shown = true;
+            statusbar_message_expired = false;
+            statusbar_message_timer = loop.addTimer(std::chrono::seconds(delay), [] {
+                statusbar_message_expired = true;
+            });
             if (Config.statusbar_visibility)
                 statusbar_block_update = true;
             else
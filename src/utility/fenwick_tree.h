@@ -0,0 +1,101 @@
+/***************************************************************************
+ *   Copyright (C) 2008-2021 by Andrzej Rybczak                            *
+ *   andrzej@rybczak.net                                                   *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.              *
+ ***************************************************************************/
+
+#ifndef NCMPCPP_UTILITY_FENWICK_TREE_H
+#define NCMPCPP_UTILITY_FENWICK_TREE_H
+
+#include <cassert>
+#include <cstddef>
+#include <vector>
+
+// Sequence of values supporting updates and prefix sum queries in O(log n) and
+// retrieval of the sum of all values in O(1).
+template <typename ValueT>
+struct FenwickTree
+{
+	FenwickTree() : m_total(0) { }
+
+	size_t size() const { return m_values.size(); }
+	bool empty() const { return m_values.empty(); }
+
+	const ValueT &operator[](size_t pos) const { return m_values[pos]; }
+
+	ValueT total() const { return m_total; }
+
+	void clear()
+	{
+		m_values.clear();
+		m_tree.clear();
+		m_total = 0;
+	}
+
+	// Sum of the first n values.
+	ValueT prefixSum(size_t n) const
+	{
+		assert(n <= size());
+		ValueT result = 0;
+		for (; n > 0; n -= lowestBit(n))
+			result += m_tree[n-1];
+		return result;
+	}
+
+	void push_back(ValueT value)
+	{
+		// node k covers values in range (k - lowestBit(k), k], so apart from the
+		// value itself it needs to include sum of its predecessors in that range.
+		size_t k = size() + 1;
+		ValueT node = value + prefixSum(k-1) - prefixSum(k - lowestBit(k));
+		m_values.push_back(value);
+		m_tree.push_back(node);
+		m_total += value;
+	}
+
+	void set(size_t pos, ValueT value)
+	{
+		assert(pos < size());
+		ValueT delta = value - m_values[pos];
+		m_values[pos] = value;
+		m_total += delta;
+		for (size_t k = pos+1; k <= size(); k += lowestBit(k))
+			m_tree[k-1] += delta;
+	}
+
+	// Nodes only depend on values at lower or equal positions,
+	// so shrinking the sequence doesn't require any rebuilding.
+	void truncate(size_t new_size)
+	{
+		for (size_t i = new_size; i < size(); ++i)
+			m_total -= m_values[i];
+		if (new_size < size())
+		{
+			m_values.resize(new_size);
+			m_tree.resize(new_size);
+		}
+	}
+
+private:
+	static size_t lowestBit(size_t n) { return n & (~n + 1); }
+
+	std::vector<ValueT> m_values;
+	std::vector<ValueT> m_tree;
+	ValueT m_total;
+};
+
+#endif // NCMPCPP_UTILITY_FENWICK_TREE_H
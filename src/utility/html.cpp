@@ -19,7 +19,7 @@
  ***************************************************************************/
 
 #include <algorithm>
-#include <boost/algorithm/string/replace.hpp>
+#include <iterator>
 #include "utility/html.h"
 
 std::string unescapeHtmlUtf8(const std::string &data)
@@ -51,47 +51,212 @@ std::string unescapeHtmlUtf8(const std::string &data)
 	return result;
 }
 
+namespace {
+
+bool isNewlineTag(const std::string &s, size_t begin, size_t end)
+{
+	return s.compare(begin, std::min<size_t>(3, end-begin), "<p ") == 0
+		|| s.compare(begin, end-begin, "<p>") == 0
+		|| s.compare(begin, end-begin, "</p>") == 0
+		|| s.compare(begin, end-begin, "<br>") == 0
+		|| s.compare(begin, end-begin, "<br/>") == 0
+		|| s.compare(begin, std::min<size_t>(4, end-begin), "<br ") == 0;
+}
+
+// Checks whether the tag s[begin, end) has the class attribute matching one
+// of the classes.
+bool hasClass(const std::string &s, size_t begin, size_t end,
+              const std::vector<std::string> &classes, bool prefix)
+{
+	// Search only within the tag, otherwise tags without the class attribute
+	// would make the search go through the rest of the page.
+	static const std::string attribute = "class=";
+	const auto tag_end = s.begin() + end;
+	for (auto it = std::search(s.begin() + begin, tag_end, attribute.begin(), attribute.end());
+	     it != tag_end;
+	     it = std::search(it + 1, tag_end, attribute.begin(), attribute.end()))
+	{
+		const size_t i = it - s.begin();
+		// Needs to be a separate attribute, not e.g. a part of data-class.
+		if (s[i-1] != ' ' && s[i-1] != '\t' && s[i-1] != '\n')
+			continue;
+		size_t value_begin = i + attribute.size();
+		if (value_begin >= end || (s[value_begin] != '"' && s[value_begin] != '\''))
+			continue;
+		const char quote = s[value_begin++];
+		const auto quote_end = std::find(s.begin() + value_begin, tag_end, quote);
+		if (quote_end == tag_end)
+			return false;
+		const size_t value_end = quote_end - s.begin();
+		const size_t value_size = value_end - value_begin;
+		for (const auto &c : classes)
+		{
+			if (prefix
+			    ? value_size >= c.size() && s.compare(value_begin, c.size(), c) == 0
+			    : s.compare(value_begin, value_size, c) == 0)
+				return true;
+		}
+		return false;
+	}
+	return false;
+}
+
+}
+
 void unescapeHtmlEntities(std::string &s)
 {
 	// well, at least some of them.
-	boost::replace_all(s, "&apos;", "'");
-	boost::replace_all(s, "&amp;", "&");
-	boost::replace_all(s, "&gt;", ">");
-	boost::replace_all(s, "&lt;", "<");
-	boost::replace_all(s, "&nbsp;", " ");
-	boost::replace_all(s, "&quot;", "\"");
-	boost::replace_all(s, "&ndash;", "–");
-	boost::replace_all(s, "&mdash;", "—");
+	static const std::pair<std::string, std::string> entities[] = {
+		{ "&apos;", "'" },
+		{ "&amp;", "&" },
+		{ "&gt;", ">" },
+		{ "&lt;", "<" },
+		{ "&nbsp;", " " },
+		{ "&quot;", "\"" },
+		{ "&ndash;", "–" },
+		{ "&mdash;", "—" },
+	};
+	// Replacements are never longer than entities, so it can be done in place.
+	size_t out = 0;
+	for (size_t i = 0; i < s.size();)
+	{
+		if (s[i] == '&')
+		{
+			auto entity = std::find_if(std::begin(entities), std::end(entities), [&](auto &e) {
+				return s.compare(i, e.first.size(), e.first) == 0;
+			});
+			if (entity != std::end(entities))
+			{
+				for (char c : entity->second)
+					s[out++] = c;
+				i += entity->first.size();
+				continue;
+			}
+		}
+		s[out++] = s[i++];
+	}
+	s.resize(out);
 }
 
 void stripHtmlTags(std::string &s)
 {
-	// Erase newlines so they don't duplicate with HTML ones.
-	s.erase(std::remove_if(s.begin(), s.end(), [](char c) {
-				return c == '\n' || c == '\r';
-			}), s.end());
-
-	bool is_newline;
-	for (size_t i = s.find("<"); i != std::string::npos; i = s.find("<"))
+	// Characters are moved to the front as tags are removed, so the part that
+	// is still to be processed is never overwritten.
+	size_t out = 0;
+	for (size_t i = 0; i < s.size();)
 	{
-		size_t j = s.find(">", i);
-		if (j != std::string::npos)
+		// Erase newlines so they don't duplicate with HTML ones.
+		if (s[i] == '\n' || s[i] == '\r')
 		{
-			++j;
-			is_newline
-				=  s.compare(i, std::min<size_t>(3, j-i), "<p ") == 0
-				|| s.compare(i, j-i, "<p>") == 0
-				|| s.compare(i, j-i, "</p>") == 0
-				|| s.compare(i, j-i, "<br>") == 0
-				|| s.compare(i, j-i, "<br/>") == 0
-				|| s.compare(i, std::min<size_t>(4, j-i), "<br ") == 0;
-			if (is_newline)
-				s.replace(i, j-i, "\n");
-			else
-				s.replace(i, j-i, "");
+			++i;
+			continue;
 		}
-		else
-			break;
+		if (s[i] == '<')
+		{
+			size_t j = s.find('>', i);
+			if (j != std::string::npos)
+			{
+				++j;
+				if (isNewlineTag(s, i, j))
+					s[out++] = '\n';
+				i = j;
+				continue;
+			}
+		}
+		s[out++] = s[i++];
 	}
+	s.resize(out);
 	unescapeHtmlEntities(s);
 }
+
+/**********************************************************************/
+
+HtmlPattern &HtmlPattern::skipPast(std::string marker)
+{
+	m_steps.push_back(Step{Type::SkipPast, std::move(marker), {}, false});
+	return *this;
+}
+
+HtmlPattern &HtmlPattern::skipPastLast(std::string marker)
+{
+	m_steps.push_back(Step{Type::SkipPastLast, std::move(marker), {}, false});
+	return *this;
+}
+
+HtmlPattern &HtmlPattern::skipPastElement(std::string tag, std::string class_)
+{
+	m_steps.push_back(Step{Type::SkipPastElement, "<" + tag, {std::move(class_)}, false});
+	return *this;
+}
+
+HtmlPattern &HtmlPattern::skipPastElementByPrefix(std::string tag,
+                                                  std::vector<std::string> prefixes)
+{
+	m_steps.push_back(Step{Type::SkipPastElement, "<" + tag, std::move(prefixes), true});
+	return *this;
+}
+
+HtmlPattern &HtmlPattern::captureUntil(std::string terminator)
+{
+	m_steps.push_back(Step{Type::Capture, std::move(terminator), {}, false});
+	return *this;
+}
+
+std::vector<std::string> HtmlPattern::extract(const std::string &data) const
+{
+	std::vector<std::string> result;
+	if (m_steps.empty())
+		return result;
+
+	size_t pos = 0;
+	while (true)
+	{
+		std::string content;
+		for (const auto &step : m_steps)
+		{
+			size_t i;
+			switch (step.type)
+			{
+			case Type::SkipPast:
+				i = data.find(step.marker, pos);
+				if (i == std::string::npos)
+					return result;
+				pos = i + step.marker.size();
+				break;
+			case Type::SkipPastLast:
+				i = data.rfind(step.marker);
+				if (i == std::string::npos || i < pos)
+					return result;
+				pos = i + step.marker.size();
+				break;
+			case Type::SkipPastElement:
+				for (i = data.find(step.marker, pos); ; i = data.find(step.marker, i + 1))
+				{
+					if (i == std::string::npos)
+						return result;
+					size_t name_end = i + step.marker.size();
+					size_t tag_end = data.find('>', name_end);
+					if (tag_end == std::string::npos)
+						return result;
+					// Make sure that the tag name is complete.
+					if (data[name_end] != ' ' && data[name_end] != '\t' && data[name_end] != '\n')
+						continue;
+					if (hasClass(data, name_end, tag_end, step.classes, step.prefix))
+					{
+						pos = tag_end + 1;
+						break;
+					}
+				}
+				break;
+			case Type::Capture:
+				i = data.find(step.marker, pos);
+				if (i == std::string::npos)
+					return result;
+				content.append(data, pos, i - pos);
+				pos = i + step.marker.size();
+				break;
+			}
+		}
+		result.push_back(std::move(content));
+	}
+}
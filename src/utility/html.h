@@ -22,9 +22,49 @@
 #define NCMPCPP_UTILITY_HTML_H
 
 #include <string>
+#include <vector>
 
 std::string unescapeHtmlUtf8(const std::string &s);
 void unescapeHtmlEntities(std::string &s);
 void stripHtmlTags(std::string &s);
 
+// Pattern for extracting parts of HTML pages in a single pass without
+// backtracking. It's a sequence of steps, each of which either skips a part
+// of the page or captures it. Steps are matched one after another from the
+// position where the previous one ended and the whole sequence is matched
+// repeatedly until one of them fails.
+struct HtmlPattern
+{
+	// Skip past the first occurrence of the marker.
+	HtmlPattern &skipPast(std::string marker);
+
+	// Skip past the last occurrence of the marker.
+	HtmlPattern &skipPastLast(std::string marker);
+
+	// Skip past the start tag of the first element with the class attribute
+	// equal to the given one or beginning with one of the given prefixes.
+	HtmlPattern &skipPastElement(std::string tag, std::string class_);
+	HtmlPattern &skipPastElementByPrefix(std::string tag, std::vector<std::string> prefixes);
+
+	// Capture everything up to the first occurrence of the terminator and
+	// skip past it.
+	HtmlPattern &captureUntil(std::string terminator);
+
+	// Returns concatenated captures of each match.
+	std::vector<std::string> extract(const std::string &data) const;
+
+private:
+	enum class Type { SkipPast, SkipPastLast, SkipPastElement, Capture };
+
+	struct Step
+	{
+		Type type;
+		std::string marker;
+		std::vector<std::string> classes;
+		bool prefix;
+	};
+
+	std::vector<Step> m_steps;
+};
+
 #endif // NCMPCPP_UTILITY_HTML_H
@@ -0,0 +1,182 @@
+/***************************************************************************
+ *   Copyright (C) 2008-2021 by Andrzej Rybczak                            *
+ *   andrzej@rybczak.net                                                   *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.              *
+ ***************************************************************************/
+
+#include <arpa/inet.h>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <netinet/in.h>
+#include <poll.h>
+#include <stdexcept>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "utility/local_http_server.h"
+
+namespace {
+
+bool sendAll(int fd, const std::string &data)
+{
+	size_t sent = 0;
+	while (sent < data.size())
+	{
+		ssize_t r = send(fd, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+		if (r < 0 && errno == EINTR)
+			continue;
+		if (r < 0)
+			return false;
+		sent += r;
+	}
+	return true;
+}
+
+std::string response(const char *status, const std::string &body)
+{
+	std::string result = "HTTP/1.1 ";
+	result += status;
+	result += "\r\nContent-Type: text/html; charset=utf-8\r\nContent-Length: ";
+	result += std::to_string(body.size());
+	result += "\r\nConnection: close\r\n\r\n";
+	result += body;
+	return result;
+}
+
+}
+
+LocalHTTPServer::LocalHTTPServer(Handler handler, unsigned latency_ms, unsigned failure_rate)
+: m_handler(std::move(handler))
+, m_latency_ms(latency_ms)
+, m_failure_rate(failure_rate)
+, m_listen_fd(-1)
+, m_port(0)
+, m_stopped(false)
+, m_random(std::random_device()())
+{ }
+
+LocalHTTPServer::~LocalHTTPServer()
+{
+	stop();
+}
+
+void LocalHTTPServer::start()
+{
+	m_listen_fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+	if (m_listen_fd < 0)
+		throw std::runtime_error(std::string("couldn't create socket: ") + strerror(errno));
+
+	sockaddr_in addr;
+	memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	addr.sin_port = 0;
+	socklen_t addr_len = sizeof(addr);
+	if (bind(m_listen_fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) < 0
+	    || listen(m_listen_fd, 16) < 0
+	    || getsockname(m_listen_fd, reinterpret_cast<sockaddr *>(&addr), &addr_len) < 0)
+	{
+		std::string error = strerror(errno);
+		close(m_listen_fd);
+		m_listen_fd = -1;
+		throw std::runtime_error("couldn't listen on the loopback interface: " + error);
+	}
+	m_port = ntohs(addr.sin_port);
+	m_acceptor = std::thread(&LocalHTTPServer::acceptConnections, this);
+}
+
+void LocalHTTPServer::stop()
+{
+	if (m_listen_fd < 0)
+		return;
+	m_stopped = true;
+	m_acceptor.join();
+	close(m_listen_fd);
+	m_listen_fd = -1;
+	for (auto &t : m_connections)
+		t.join();
+	m_connections.clear();
+}
+
+std::string LocalHTTPServer::url() const
+{
+	return "http://127.0.0.1:" + std::to_string(m_port);
+}
+
+void LocalHTTPServer::acceptConnections()
+{
+	pollfd pfd;
+	pfd.fd = m_listen_fd;
+	pfd.events = POLLIN;
+	while (!m_stopped)
+	{
+		// Wake up periodically to check whether the server was stopped.
+		if (poll(&pfd, 1, 100) <= 0)
+			continue;
+		int fd = accept4(m_listen_fd, nullptr, nullptr, SOCK_CLOEXEC);
+		if (fd < 0)
+			continue;
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_connections.emplace_back(&LocalHTTPServer::handleConnection, this, fd);
+	}
+}
+
+void LocalHTTPServer::handleConnection(int fd)
+{
+	// Read the request up to the end of headers, only the request line is
+	// relevant.
+	std::string request;
+	char buf[4096];
+	while (request.find("\r\n\r\n") == std::string::npos)
+	{
+		ssize_t r = recv(fd, buf, sizeof(buf), 0);
+		if (r < 0 && errno == EINTR)
+			continue;
+		if (r <= 0)
+			break;
+		request.append(buf, r);
+	}
+
+	std::this_thread::sleep_for(std::chrono::milliseconds(m_latency_ms));
+
+	// Request line is "GET /target HTTP/1.1".
+	size_t target_begin = request.find(' ');
+	size_t target_end = target_begin == std::string::npos
+		? std::string::npos
+		: request.find(' ', target_begin + 1);
+	if (target_end == std::string::npos || request.compare(0, target_begin, "GET") != 0)
+		sendAll(fd, response("400 Bad Request", ""));
+	else if (shouldFail())
+		sendAll(fd, response("503 Service Unavailable", ""));
+	else
+	{
+		// Strip the leading slash.
+		auto target = request.substr(target_begin + 2, target_end - target_begin - 2);
+		if (auto body = m_handler(target))
+			sendAll(fd, response("200 OK", *body));
+		else
+			sendAll(fd, response("404 Not Found", ""));
+	}
+	close(fd);
+}
+
+bool LocalHTTPServer::shouldFail()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return std::uniform_int_distribution<unsigned>(0, 99)(m_random) < m_failure_rate;
+}
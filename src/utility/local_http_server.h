@@ -0,0 +1,74 @@
+/***************************************************************************
+ *   Copyright (C) 2008-2021 by Andrzej Rybczak                            *
+ *   andrzej@rybczak.net                                                   *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.              *
+ ***************************************************************************/
+
+#ifndef NCMPCPP_UTILITY_LOCAL_HTTP_SERVER_H
+#define NCMPCPP_UTILITY_LOCAL_HTTP_SERVER_H
+
+#include <atomic>
+#include <functional>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include <boost/optional.hpp>
+
+// Minimal HTTP server on the loopback interface that stands in for real
+// servers in tests. Each GET request is answered with the body returned by
+// the handler for the request target (or 404 if there is none) after the
+// given latency, unless it's picked to fail with 503 according to the
+// failure rate. Every connection is handled by a separate thread.
+struct LocalHTTPServer
+{
+	typedef std::function<boost::optional<std::string>(const std::string &)> Handler;
+
+	LocalHTTPServer(Handler handler, unsigned latency_ms, unsigned failure_rate);
+	~LocalHTTPServer();
+
+	LocalHTTPServer(const LocalHTTPServer &) = delete;
+	LocalHTTPServer &operator=(const LocalHTTPServer &) = delete;
+
+	// Throws std::runtime_error if the server couldn't be started.
+	void start();
+	void stop();
+
+	// URL of the server, e.g. http://127.0.0.1:8000.
+	std::string url() const;
+
+private:
+	void acceptConnections();
+	void handleConnection(int fd);
+	bool shouldFail();
+
+	Handler m_handler;
+	unsigned m_latency_ms;
+	unsigned m_failure_rate;
+
+	int m_listen_fd;
+	unsigned m_port;
+	std::atomic<bool> m_stopped;
+	std::thread m_acceptor;
+
+	std::mutex m_mutex;
+	std::vector<std::thread> m_connections;
+	std::minstd_rand m_random;
+};
+
+#endif // NCMPCPP_UTILITY_LOCAL_HTTP_SERVER_H
@@ -0,0 +1,338 @@
+/***************************************************************************
+ *   Copyright (C) 2008-2021 by Andrzej Rybczak                            *
+ *   andrzej@rybczak.net                                                   *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.              *
+ ***************************************************************************/
+
+#include <algorithm>
+#include <boost/lexical_cast.hpp>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+
+#include "utility/pcm.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+# define NCMPCPP_PCM_X86
+# include <immintrin.h>
+#endif
+
+namespace {
+
+int32_t clampToSample(int32_t value)
+{
+	return std::min<int32_t>(
+		std::max<int32_t>(value, std::numeric_limits<int16_t>::min()),
+		std::numeric_limits<int16_t>::max());
+}
+
+int32_t peakScalar(const int16_t *samples, size_t n)
+{
+	int32_t peak = 0;
+	for (size_t i = 0; i < n; ++i)
+		peak = std::max(peak, std::abs(int32_t(samples[i])));
+	return peak;
+}
+
+void scaleScalar(int16_t *samples, size_t n, float multiplier)
+{
+	for (size_t i = 0; i < n; ++i)
+		samples[i] = clampToSample(samples[i] * multiplier);
+}
+
+void deinterleaveScalar(const int16_t *samples, size_t frames, int16_t *left, int16_t *right)
+{
+	for (size_t i = 0; i < frames; ++i)
+	{
+		left[i] = samples[2*i];
+		right[i] = samples[2*i+1];
+	}
+}
+
+#ifdef NCMPCPP_PCM_X86
+
+// Minimum and maximum are tracked separately, because the absolute value of
+// -32768 doesn't fit into int16_t.
+__attribute__((target("sse2")))
+int32_t peakSSE2(const int16_t *samples, size_t n)
+{
+	__m128i min = _mm_setzero_si128(), max = _mm_setzero_si128();
+	size_t i = 0;
+	for (; i + 8 <= n; i += 8)
+	{
+		__m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(samples + i));
+		min = _mm_min_epi16(min, v);
+		max = _mm_max_epi16(max, v);
+	}
+	int16_t mins[8], maxs[8];
+	_mm_storeu_si128(reinterpret_cast<__m128i *>(mins), min);
+	_mm_storeu_si128(reinterpret_cast<__m128i *>(maxs), max);
+	int32_t peak = peakScalar(samples + i, n - i);
+	for (size_t j = 0; j < 8; ++j)
+		peak = std::max({peak, -int32_t(mins[j]), int32_t(maxs[j])});
+	return peak;
+}
+
+__attribute__((target("sse2")))
+void scaleSSE2(int16_t *samples, size_t n, float multiplier)
+{
+	const __m128 m = _mm_set1_ps(multiplier);
+	size_t i = 0;
+	for (; i + 8 <= n; i += 8)
+	{
+		__m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(samples + i));
+		// sign extend to 32 bits
+		__m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16);
+		__m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(v, v), 16);
+		lo = _mm_cvttps_epi32(_mm_mul_ps(_mm_cvtepi32_ps(lo), m));
+		hi = _mm_cvttps_epi32(_mm_mul_ps(_mm_cvtepi32_ps(hi), m));
+		_mm_storeu_si128(reinterpret_cast<__m128i *>(samples + i), _mm_packs_epi32(lo, hi));
+	}
+	scaleScalar(samples + i, n - i, multiplier);
+}
+
+__attribute__((target("sse2")))
+void deinterleaveSSE2(const int16_t *samples, size_t frames, int16_t *left, int16_t *right)
+{
+	size_t i = 0;
+	for (; i + 8 <= frames; i += 8)
+	{
+		__m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i *>(samples + 2*i));
+		__m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i *>(samples + 2*i + 8));
+		// Left channel occupies lower halves of 32 bit lanes, right one the
+		// upper halves. Both are sign extended, so packing doesn't saturate.
+		__m128i la = _mm_srai_epi32(_mm_slli_epi32(a, 16), 16);
+		__m128i lb = _mm_srai_epi32(_mm_slli_epi32(b, 16), 16);
+		__m128i ra = _mm_srai_epi32(a, 16);
+		__m128i rb = _mm_srai_epi32(b, 16);
+		_mm_storeu_si128(reinterpret_cast<__m128i *>(left + i), _mm_packs_epi32(la, lb));
+		_mm_storeu_si128(reinterpret_cast<__m128i *>(right + i), _mm_packs_epi32(ra, rb));
+	}
+	deinterleaveScalar(samples + 2*i, frames - i, left + i, right + i);
+}
+
+__attribute__((target("avx2")))
+int32_t peakAVX2(const int16_t *samples, size_t n)
+{
+	__m256i min = _mm256_setzero_si256(), max = _mm256_setzero_si256();
+	size_t i = 0;
+	for (; i + 16 <= n; i += 16)
+	{
+		__m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(samples + i));
+		min = _mm256_min_epi16(min, v);
+		max = _mm256_max_epi16(max, v);
+	}
+	int16_t mins[16], maxs[16];
+	_mm256_storeu_si256(reinterpret_cast<__m256i *>(mins), min);
+	_mm256_storeu_si256(reinterpret_cast<__m256i *>(maxs), max);
+	int32_t peak = peakScalar(samples + i, n - i);
+	for (size_t j = 0; j < 16; ++j)
+		peak = std::max({peak, -int32_t(mins[j]), int32_t(maxs[j])});
+	return peak;
+}
+
+// 256 bit packing works within 128 bit lanes, so its result needs to have
+// 64 bit quarters 1 and 2 swapped to restore the order of samples.
+
+__attribute__((target("avx2")))
+void scaleAVX2(int16_t *samples, size_t n, float multiplier)
+{
+	const __m256 m = _mm256_set1_ps(multiplier);
+	size_t i = 0;
+	for (; i + 16 <= n; i += 16)
+	{
+		__m128i vlo = _mm_loadu_si128(reinterpret_cast<const __m128i *>(samples + i));
+		__m128i vhi = _mm_loadu_si128(reinterpret_cast<const __m128i *>(samples + i + 8));
+		__m256i lo = _mm256_cvttps_epi32(_mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(vlo)), m));
+		__m256i hi = _mm256_cvttps_epi32(_mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(vhi)), m));
+		__m256i packed = _mm256_permute4x64_epi64(_mm256_packs_epi32(lo, hi), 0xD8);
+		_mm256_storeu_si256(reinterpret_cast<__m256i *>(samples + i), packed);
+	}
+	scaleSSE2(samples + i, n - i, multiplier);
+}
+
+__attribute__((target("avx2")))
+void deinterleaveAVX2(const int16_t *samples, size_t frames, int16_t *left, int16_t *right)
+{
+	size_t i = 0;
+	for (; i + 16 <= frames; i += 16)
+	{
+		__m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(samples + 2*i));
+		__m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(samples + 2*i + 16));
+		__m256i la = _mm256_srai_epi32(_mm256_slli_epi32(a, 16), 16);
+		__m256i lb = _mm256_srai_epi32(_mm256_slli_epi32(b, 16), 16);
+		__m256i ra = _mm256_srai_epi32(a, 16);
+		__m256i rb = _mm256_srai_epi32(b, 16);
+		_mm256_storeu_si256(reinterpret_cast<__m256i *>(left + i),
+		                    _mm256_permute4x64_epi64(_mm256_packs_epi32(la, lb), 0xD8));
+		_mm256_storeu_si256(reinterpret_cast<__m256i *>(right + i),
+		                    _mm256_permute4x64_epi64(_mm256_packs_epi32(ra, rb), 0xD8));
+	}
+	deinterleaveSSE2(samples + 2*i, frames - i, left + i, right + i);
+}
+
+#endif // NCMPCPP_PCM_X86
+
+template <typename SampleT, typename ToS16T>
+void convertFrames(const void *input, size_t frames, unsigned in_channels,
+                   int16_t *output, unsigned out_channels, ToS16T to_s16)
+{
+	auto samples = static_cast<const SampleT *>(input);
+	for (size_t i = 0; i < frames; ++i, samples += in_channels)
+	{
+		if (out_channels == 1)
+		{
+			int32_t sum = 0;
+			for (unsigned c = 0; c < in_channels; ++c)
+				sum += to_s16(samples[c]);
+			*output++ = sum / int32_t(in_channels);
+		}
+		else
+		{
+			for (unsigned c = 0; c < out_channels; ++c)
+				*output++ = to_s16(samples[std::min(c, in_channels-1)]);
+		}
+	}
+}
+
+struct Kernels
+{
+	int32_t (*peak)(const int16_t *, size_t);
+	void (*scale)(int16_t *, size_t, float);
+	void (*deinterleave)(const int16_t *, size_t, int16_t *, int16_t *);
+};
+
+Kernels selectKernels()
+{
+#ifdef NCMPCPP_PCM_X86
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx2"))
+		return { peakAVX2, scaleAVX2, deinterleaveAVX2 };
+	if (__builtin_cpu_supports("sse2"))
+		return { peakSSE2, scaleSSE2, deinterleaveSSE2 };
+#endif // NCMPCPP_PCM_X86
+	return { peakScalar, scaleScalar, deinterleaveScalar };
+}
+
+const Kernels &kernels()
+{
+	static const Kernels k = selectKernels();
+	return k;
+}
+
+}
+
+int32_t pcmPeak(const int16_t *samples, size_t n)
+{
+	return kernels().peak(samples, n);
+}
+
+void pcmScale(int16_t *samples, size_t n, float multiplier)
+{
+	kernels().scale(samples, n, multiplier);
+}
+
+void pcmDeinterleave(const int16_t *samples, size_t frames, int16_t *left, int16_t *right)
+{
+	kernels().deinterleave(samples, frames, left, right);
+}
+
+size_t PCMFormat::sampleSize() const
+{
+	switch (type)
+	{
+		case SampleType::S8:
+			return 1;
+		case SampleType::S16:
+			return 2;
+		case SampleType::S24:
+		case SampleType::S32:
+		case SampleType::Float:
+			return 4;
+	}
+	return 0;
+}
+
+boost::optional<PCMFormat> parsePCMFormat(const std::string &s)
+{
+	boost::optional<PCMFormat> result;
+	auto first = s.find(':');
+	auto second = s.find(':', first == std::string::npos ? first : first+1);
+	if (first == std::string::npos || second == std::string::npos)
+		return result;
+	PCMFormat format;
+	try
+	{
+		format.rate = boost::lexical_cast<unsigned>(s.substr(0, first));
+		format.channels = boost::lexical_cast<unsigned>(s.substr(second+1));
+	}
+	catch (boost::bad_lexical_cast &)
+	{
+		return result;
+	}
+	auto bits = s.substr(first+1, second-first-1);
+	if (bits == "8")
+		format.type = PCMFormat::SampleType::S8;
+	else if (bits == "16")
+		format.type = PCMFormat::SampleType::S16;
+	else if (bits == "24")
+		format.type = PCMFormat::SampleType::S24;
+	else if (bits == "32")
+		format.type = PCMFormat::SampleType::S32;
+	else if (bits == "f")
+		format.type = PCMFormat::SampleType::Float;
+	else
+		return result;
+	if (format.rate > 0 && format.channels > 0)
+		result = format;
+	return result;
+}
+
+void pcmConvert(const void *input, size_t frames, const PCMFormat &format,
+                int16_t *output, unsigned channels)
+{
+	switch (format.type)
+	{
+		case PCMFormat::SampleType::S8:
+			convertFrames<int8_t>(input, frames, format.channels, output, channels,
+			                      [](int8_t s) { return int32_t(s) * 256; });
+			break;
+		case PCMFormat::SampleType::S16:
+			if (format.channels == channels)
+				std::memcpy(output, input, frames * channels * sizeof(int16_t));
+			else
+				convertFrames<int16_t>(input, frames, format.channels, output, channels,
+				                       [](int16_t s) { return int32_t(s); });
+			break;
+		case PCMFormat::SampleType::S24:
+			convertFrames<int32_t>(input, frames, format.channels, output, channels,
+			                       [](int32_t s) { return s / 256; });
+			break;
+		case PCMFormat::SampleType::S32:
+			convertFrames<int32_t>(input, frames, format.channels, output, channels,
+			                       [](int32_t s) { return s / 65536; });
+			break;
+		case PCMFormat::SampleType::Float:
+			convertFrames<float>(input, frames, format.channels, output, channels,
+			                     [](float s) {
+				                     // clamp before conversion, out of range
+				                     // floats can't be converted to integers
+				                     return int32_t(std::max(-32768.f, std::min(s * 32767, 32767.f)));
+			                     });
+			break;
+	}
+}
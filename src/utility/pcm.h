@@ -0,0 +1,69 @@
+/***************************************************************************
+ *   Copyright (C) 2008-2021 by Andrzej Rybczak                            *
+ *   andrzej@rybczak.net                                                   *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.              *
+ ***************************************************************************/
+
+#ifndef NCMPCPP_UTILITY_PCM_H
+#define NCMPCPP_UTILITY_PCM_H
+
+#include <boost/optional.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+struct PCMFormat
+{
+	enum class SampleType { S8, S16, S24, S32, Float };
+
+	PCMFormat() : rate(44100), type(SampleType::S16), channels(2) { }
+	PCMFormat(unsigned rate_, SampleType type_, unsigned channels_)
+		: rate(rate_), type(type_), channels(channels_) { }
+
+	// Size of a single sample in bytes. 24 bit samples are stored in 32 bits.
+	size_t sampleSize() const;
+	size_t frameSize() const { return sampleSize() * channels; }
+
+	unsigned rate;
+	SampleType type;
+	unsigned channels;
+};
+
+// Parses format in the notation used by MPD, i.e. rate:bits:channels where
+// bits is one of 8, 16, 24, 32 or f for floating point samples.
+boost::optional<PCMFormat> parsePCMFormat(const std::string &s);
+
+// Converts frames in the given format to 16 bit samples with the given number
+// of channels. Mono output is an average of all input channels, stereo output
+// takes the first two input channels (or duplicates the only one).
+void pcmConvert(const void *input, size_t frames, const PCMFormat &format,
+                int16_t *output, unsigned channels);
+
+// Kernels for processing of 16 bit PCM samples. On x86 SSE2 or AVX2
+// implementations are selected at runtime if the CPU supports them.
+
+// Returns the maximum absolute value of samples.
+int32_t pcmPeak(const int16_t *samples, size_t n);
+
+// Multiplies samples by multiplier, rounding towards zero and saturating
+// results to the range of int16_t.
+void pcmScale(int16_t *samples, size_t n, float multiplier);
+
+// Splits interleaved stereo samples into separate channels.
+void pcmDeinterleave(const int16_t *samples, size_t frames, int16_t *left, int16_t *right);
+
+#endif // NCMPCPP_UTILITY_PCM_H
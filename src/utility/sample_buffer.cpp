@@ -18,76 +18,64 @@
  *   51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.              *
  ***************************************************************************/
 
+#include <algorithm>
 #include <stdexcept>
 
 #include "utility/sample_buffer.h"
 
-void SampleBuffer::put(SampleBuffer::Iterator begin, SampleBuffer::Iterator end)
+void SampleBuffer::put(const int16_t *samples, size_t n)
 {
-	size_t elems = end - begin;
-	if (elems > m_buffer.size())
+	if (n > m_buffer.size() - m_window)
 		throw std::out_of_range("Size of the buffer is smaller than the amount of elements");
 
-	size_t free_elems = m_buffer.size() - m_offset;
-	if (elems > free_elems)
-	{
-		size_t to_remove = elems - free_elems;
-		std::copy(m_buffer.begin() + to_remove, m_buffer.end() - free_elems,
-		          m_buffer.begin());
-		m_offset -= to_remove;
-	}
-	std::copy(begin, end, m_buffer.begin() + m_offset);
-	m_offset += elems;
+	size_t pos = m_write & m_mask;
+	size_t first = std::min(n, m_buffer.size() - pos);
+	std::copy(samples, samples + first, m_buffer.begin() + pos);
+	std::copy(samples + first, samples + n, m_buffer.begin());
+	m_write += n;
+
+	// If there is no space left, discard the oldest samples that weren't
+	// consumed yet so that the window stays intact.
+	if (m_write - m_read > m_buffer.size() - m_window)
+		m_read = m_write - (m_buffer.size() - m_window);
 }
 
-size_t SampleBuffer::get(size_t elems, std::vector<int16_t> &dest)
+size_t SampleBuffer::consume(size_t n)
 {
-	if (m_offset == 0)
-		return 0;
-
-	// If the amount of requested samples is bigger than available, return only
-	// available.
-	if (elems > m_offset)
-		elems = m_offset;
-
-	if (elems >= dest.size())
-	{
-		// If dest is smaller than the available amount of samples, discard the
-		// ones that come first.
-		size_t elems_lost = elems - dest.size();
-		std::copy(m_buffer.begin() + elems_lost, m_buffer.begin() + elems, dest.begin());
-	}
-	else
-	{
-		// Copy samples to the destination buffer.
-		std::copy(dest.begin() + elems, dest.end(), dest.begin());
-		std::copy(m_buffer.begin(), m_buffer.begin() + elems, dest.end() - elems);
-	}
-
-	// Remove them from the internal buffer.
-	std::copy(m_buffer.begin() + elems, m_buffer.begin() + m_offset, m_buffer.begin());
-	m_offset -= elems;
+	// If the amount of requested samples is bigger than available, consume
+	// only available.
+	n = std::min(n, size());
+	m_read += n;
+	return n;
+}
 
-	return elems;
+SampleBuffer::Span SampleBuffer::window() const
+{
+	size_t pos = (m_read - m_window) & m_mask;
+	size_t first = std::min(m_window, m_buffer.size() - pos);
+	return Span(m_buffer.data() + pos, first,
+	            m_buffer.data(), m_window - first);
 }
 
-void SampleBuffer::resize(size_t n)
+void SampleBuffer::resize(size_t backlog, size_t window)
 {
+	size_t n = 1;
+	while (n < backlog + window)
+		n <<= 1;
 	m_buffer.resize(n);
+	m_mask = n - 1;
+	m_window = window;
 	clear();
 }
 
 void SampleBuffer::clear()
 {
-	m_offset = 0;
+	// Window of the initial position consists of silence.
+	std::fill(m_buffer.begin(), m_buffer.end(), 0);
+	m_read = m_write = m_window;
 }
 
 size_t SampleBuffer::size() const
 {
-	return m_offset;
-}
-
-const std::vector<int16_t> &SampleBuffer::buffer() const
-{
-	return m_buffer;
+	return m_write - m_read;
 }
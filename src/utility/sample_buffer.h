@@ -21,27 +21,58 @@
 #ifndef NCMPCPP_SAMPLE_BUFFER_H
 #define NCMPCPP_SAMPLE_BUFFER_H
 
+#include <cstddef>
 #include <cstdint>
 #include <vector>
 
+// Ring of samples with a power-of-two capacity. Samples that were already
+// consumed are kept around, so that the window of the most recently consumed
+// ones can be accessed in place.
 struct SampleBuffer
 {
-	typedef std::vector<int16_t>::iterator Iterator;
+	// Contiguous view of samples, split in two parts if it crosses the end of
+	// the underlying storage.
+	struct Span
+	{
+		Span(const int16_t *data, size_t size)
+		: first(data), first_size(size), second(nullptr), second_size(0) { }
 
-	SampleBuffer() : m_offset(0) { }
+		Span(const int16_t *first_, size_t first_size_,
+		     const int16_t *second_, size_t second_size_)
+		: first(first_), first_size(first_size_)
+		, second(second_), second_size(second_size_) { }
 
-	void put(Iterator begin, Iterator end);
-	size_t get(size_t elems, std::vector<int16_t> &dest);
+		size_t size() const { return first_size + second_size; }
 
-	void resize(size_t n);
+		int16_t operator[](size_t i) const
+		{
+			return i < first_size ? first[i] : second[i - first_size];
+		}
+
+		const int16_t *first;
+		size_t first_size;
+		const int16_t *second;
+		size_t second_size;
+	};
+
+	SampleBuffer() : m_mask(0), m_window(0), m_read(0), m_write(0) { }
+
+	void put(const int16_t *samples, size_t n);
+	size_t consume(size_t n);
+	Span window() const;
+
+	void resize(size_t backlog, size_t window);
 	void clear();
 
 	size_t size() const;
-	const std::vector<int16_t> &buffer() const;
 
 private:
-	size_t m_offset;
 	std::vector<int16_t> m_buffer;
+	size_t m_mask;
+	size_t m_window;
+
+	size_t m_read;
+	size_t m_write;
 };
 
 #endif // NCMPCPP_SAMPLE_BUFFER_H
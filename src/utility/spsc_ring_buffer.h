@@ -0,0 +1,110 @@
+/***************************************************************************
+ *   Copyright (C) 2008-2021 by Andrzej Rybczak                            *
+ *   andrzej@rybczak.net                                                   *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.              *
+ ***************************************************************************/
+
+#ifndef NCMPCPP_UTILITY_SPSC_RING_BUFFER_H
+#define NCMPCPP_UTILITY_SPSC_RING_BUFFER_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+// Lock-free ring buffer for exactly one producer and one consumer thread.
+// Capacity is rounded up to a power of two, positions are kept as ever
+// increasing counters and masked on access.
+template <typename ValueT>
+struct SPSCRingBuffer
+{
+	SPSCRingBuffer() : m_mask(0), m_head(0), m_tail(0) { }
+
+	// Not thread safe, neither producer nor consumer may be active.
+	void resize(size_t capacity)
+	{
+		size_t n = 1;
+		while (n < capacity)
+			n <<= 1;
+		m_buffer.assign(n, ValueT());
+		m_mask = n-1;
+		m_head = 0;
+		m_tail = 0;
+	}
+
+	size_t capacity() const { return m_buffer.size(); }
+
+	size_t size() const
+	{
+		return m_head.load(std::memory_order_acquire)
+			- m_tail.load(std::memory_order_acquire);
+	}
+
+	// Producer side. Writes as many values as there is space for and returns
+	// their amount, the rest is dropped.
+	size_t write(const ValueT *data, size_t n)
+	{
+		size_t head = m_head.load(std::memory_order_relaxed);
+		size_t tail = m_tail.load(std::memory_order_acquire);
+		n = std::min(n, capacity() - (head - tail));
+		size_t pos = head & m_mask;
+		size_t first = std::min(n, capacity() - pos);
+		std::copy(data, data+first, m_buffer.begin()+pos);
+		std::copy(data+first, data+n, m_buffer.begin());
+		m_head.store(head+n, std::memory_order_release);
+		return n;
+	}
+
+	// Consumer side. Reads at most n values and returns their amount.
+	size_t read(ValueT *data, size_t n)
+	{
+		size_t tail = m_tail.load(std::memory_order_relaxed);
+		size_t head = m_head.load(std::memory_order_acquire);
+		n = std::min(n, head - tail);
+		size_t pos = tail & m_mask;
+		size_t first = std::min(n, capacity() - pos);
+		std::copy(m_buffer.begin()+pos, m_buffer.begin()+pos+first, data);
+		std::copy(m_buffer.begin(), m_buffer.begin()+(n-first), data+first);
+		m_tail.store(tail+n, std::memory_order_release);
+		return n;
+	}
+
+	// Consumer side. Drops at most n oldest values and returns their amount.
+	size_t discard(size_t n)
+	{
+		size_t tail = m_tail.load(std::memory_order_relaxed);
+		size_t head = m_head.load(std::memory_order_acquire);
+		n = std::min(n, head - tail);
+		m_tail.store(tail+n, std::memory_order_release);
+		return n;
+	}
+
+	// Consumer side.
+	void clear()
+	{
+		m_tail.store(m_head.load(std::memory_order_acquire), std::memory_order_release);
+	}
+
+private:
+	std::vector<ValueT> m_buffer;
+	size_t m_mask;
+
+	std::atomic<size_t> m_head;
+	std::atomic<size_t> m_tail;
+};
+
+#endif // NCMPCPP_UTILITY_SPSC_RING_BUFFER_H
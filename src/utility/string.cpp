@@ -19,6 +19,7 @@
  ***************************************************************************/
 
 #include <cassert>
+#include <cstdint>
 #include <cwctype>
 #include <algorithm>
 #include "utility/string.h"
@@ -55,6 +56,21 @@ std::string getSharedDirectory(const std::string &dir1, const std::string &dir2)
 		return dir1.substr(0, i);
 }
 
+std::string hashString(const std::string &s)
+{
+	uint64_t hash = 14695981039346656037ULL;
+	for (char c : s)
+	{
+		hash ^= uint8_t(c);
+		hash *= 1099511628211ULL;
+	}
+	const char digits[] = "0123456789abcdef";
+	std::string result;
+	for (int i = 60; i >= 0; i -= 4)
+		result += digits[(hash >> i) & 0xf];
+	return result;
+}
+
 std::string getEnclosedString(const std::string &s, char a, char b, size_t *pos)
 {
 	std::string result;
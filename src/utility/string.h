@@ -56,6 +56,9 @@ std::string getBasename(const std::string &path);
 std::string getParentDirectory(std::string path);
 std::string getSharedDirectory(const std::string &dir1, const std::string &dir2);
 
+// 64-bit FNV-1a hash of the string in hexadecimal, stable between runs.
+std::string hashString(const std::string &s);
+
 std::string getEnclosedString(const std::string &s, char a, char b, size_t *pos);
 
 void removeInvalidCharsFromFilename(std::string &filename, bool win32_compatible);
@@ -0,0 +1,96 @@
+/***************************************************************************
+ *   Copyright (C) 2008-2021 by Andrzej Rybczak                            *
+ *   andrzej@rybczak.net                                                   *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.              *
+ ***************************************************************************/
+
+#include <algorithm>
+#include <iostream>
+#include <thread>
+
+#include "utility/thread_pool.h"
+
+ThreadPool::ThreadPool(size_t max_threads, Executor executor)
+	: m_max_threads(std::max(max_threads, size_t(1)))
+	, m_executor(std::move(executor))
+	, m_next_sequence(0)
+	, m_threads(0)
+	, m_idle_threads(0)
+	, m_low_priority_jobs(0)
+{ }
+
+void ThreadPool::submit(Priority priority, CancellationToken token, Job job)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_jobs.push(Entry{priority, m_next_sequence++, std::move(token), std::move(job)});
+	// Start a new thread only if the existing ones are busy.
+	if (m_idle_threads < m_jobs.size() && m_threads < m_max_threads)
+	{
+		std::thread(&ThreadPool::runThread, this).detach();
+		++m_threads;
+	}
+	m_cv.notify_one();
+}
+
+void ThreadPool::runThread()
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	while (true)
+	{
+		++m_idle_threads;
+		m_cv.wait(lock, [this] { return canStartJob(); });
+		--m_idle_threads;
+		// priority_queue::top returns a const reference, so the job needs to be
+		// copied. It's cheap though, jobs are usually small lambdas.
+		Entry entry = m_jobs.top();
+		m_jobs.pop();
+		if (entry.token.cancelled())
+			continue;
+		const bool low_priority = entry.priority != Priority::High;
+		if (low_priority)
+			++m_low_priority_jobs;
+		lock.unlock();
+		try
+		{
+			entry.job();
+		}
+		catch (std::exception &e)
+		{
+			std::cerr << "Background job failed: " << e.what() << "\n";
+		}
+		catch (...)
+		{
+			std::cerr << "Background job failed\n";
+		}
+		lock.lock();
+		if (low_priority)
+		{
+			--m_low_priority_jobs;
+			// Other threads might be waiting for the job to finish.
+			m_cv.notify_one();
+		}
+	}
+}
+
+bool ThreadPool::canStartJob() const
+{
+	if (m_jobs.empty())
+		return false;
+	// High priority jobs are at the top of the queue if there are any.
+	return m_jobs.top().priority == Priority::High
+		|| m_low_priority_jobs < maxLowPriorityJobs();
+}
@@ -0,0 +1,134 @@
+/***************************************************************************
+ *   Copyright (C) 2008-2021 by Andrzej Rybczak                            *
+ *   andrzej@rybczak.net                                                   *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.              *
+ ***************************************************************************/
+
+#ifndef NCMPCPP_UTILITY_THREAD_POOL_H
+#define NCMPCPP_UTILITY_THREAD_POOL_H
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <vector>
+
+// Bounded pool of threads running background jobs. Jobs with higher priority
+// are started first, jobs with the same priority in order of submission.
+// Unless the pool has a single thread, one of them is reserved for jobs with
+// high priority, so that they don't wait for long running ones with lower
+// priority. Threads are started on demand, up to the given maximum, and live
+// until the program exits. Completions of jobs are handed to the executor
+// given in the constructor, which is supposed to run them in the main thread.
+struct ThreadPool
+{
+	typedef std::function<void()> Job;
+	typedef std::function<void(Job)> Executor;
+
+	enum class Priority { Low, Normal, High };
+
+	// Cancels jobs sharing the token. Jobs that haven't started yet are
+	// dropped, running ones need to check cancelled() or flag() themselves
+	// and their completions are not invoked.
+	struct CancellationToken
+	{
+		CancellationToken()
+			: m_cancelled(std::make_shared<std::atomic<bool>>(false))
+		{ }
+
+		void cancel() { m_cancelled->store(true); }
+		bool cancelled() const { return m_cancelled->load(); }
+
+		const std::shared_ptr<std::atomic<bool>> &flag() const { return m_cancelled; }
+
+	private:
+		std::shared_ptr<std::atomic<bool>> m_cancelled;
+	};
+
+	ThreadPool(size_t max_threads, Executor executor);
+
+	ThreadPool(const ThreadPool &) = delete;
+	ThreadPool &operator=(const ThreadPool &) = delete;
+
+	void submit(Priority priority, CancellationToken token, Job job);
+
+	void submit(Priority priority, Job job)
+	{
+		submit(priority, CancellationToken(), std::move(job));
+	}
+
+	// Runs work in one of the threads and passes its result to done via the
+	// executor, unless the token was cancelled in the meantime. If work throws,
+	// done is not invoked, so work needs to handle its own failures.
+	template <typename WorkT, typename DoneT>
+	void submit(Priority priority, CancellationToken token, WorkT work, DoneT done)
+	{
+		submit(priority, token, [this, token, work, done]() {
+			typedef decltype(work()) ResultT;
+			auto result = std::make_shared<ResultT>(work());
+			if (!token.cancelled())
+				m_executor([token, done, result]() {
+					if (!token.cancelled())
+						done(std::move(*result));
+				});
+		});
+	}
+
+	size_t maxThreads() const { return m_max_threads; }
+
+	// Maximum number of jobs with lower than high priority running at once.
+	size_t maxLowPriorityJobs() const
+	{
+		return std::max(m_max_threads, size_t(2)) - 1;
+	}
+
+private:
+	struct Entry
+	{
+		Priority priority;
+		uint64_t sequence;
+		CancellationToken token;
+		Job job;
+
+		bool operator<(const Entry &rhs) const
+		{
+			if (priority != rhs.priority)
+				return priority < rhs.priority;
+			return sequence > rhs.sequence;
+		}
+	};
+
+	void runThread();
+	bool canStartJob() const;
+
+	const size_t m_max_threads;
+	Executor m_executor;
+
+	std::mutex m_mutex;
+	std::condition_variable m_cv;
+	std::priority_queue<Entry> m_jobs;
+	uint64_t m_next_sequence;
+	size_t m_threads;
+	size_t m_idle_threads;
+	size_t m_low_priority_jobs;
+};
+
+#endif // NCMPCPP_UTILITY_THREAD_POOL_H
@@ -0,0 +1,135 @@
+/***************************************************************************
+ *   Copyright (C) 2008-2021 by Andrzej Rybczak                            *
+ *   andrzej@rybczak.net                                                   *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.              *
+ ***************************************************************************/
+
+#include <algorithm>
+#include <limits>
+
+#include "utility/timer_wheel.h"
+
+const std::chrono::milliseconds TimerWheel::Tick(10);
+
+TimerWheel::TimerWheel()
+: m_start(Clock::now()), m_current(0), m_next_id(1)
+{ }
+
+TimerWheel::TimerID TimerWheel::add(std::chrono::milliseconds delay, Callback callback,
+                                    std::chrono::milliseconds interval)
+{
+	// Round up so that the timer never fires before its deadline. Timers
+	// are expired with the next tick at the earliest, as the current one
+	// is already processed.
+	auto ticks = [](Clock::duration d) -> Ticks {
+		return d.count() <= 0 ? 0 : (d + Tick - Clock::duration(1)) / Tick;
+	};
+	Timer timer;
+	timer.id = m_next_id++;
+	// Use the exact time, now() is rounded down to the current tick.
+	timer.deadline = std::max(ticks(Clock::now() - m_start + delay), m_current + 1);
+	timer.interval = ticks(interval);
+	if (interval.count() > 0)
+		timer.interval = std::max(timer.interval, Ticks(1));
+	timer.callback = std::move(callback);
+	TimerID id = timer.id;
+	schedule(std::move(timer));
+	return id;
+}
+
+void TimerWheel::cancel(TimerID id)
+{
+	auto it = m_deadlines.find(id);
+	if (it == m_deadlines.end())
+		return;
+	auto &slot = m_slots[it->second % Slots];
+	slot.erase(std::find_if(slot.begin(), slot.end(), [id](const Timer &t) {
+		return t.id == id;
+	}));
+	m_deadlines.erase(it);
+}
+
+int TimerWheel::timeout() const
+{
+	if (m_deadlines.empty())
+		return -1;
+	// Look for the nearest deadline within one revolution of the wheel first,
+	// slot by slot. If there is none, all timers are further in the future.
+	Ticks deadline = std::numeric_limits<Ticks>::max();
+	for (Ticks tick = m_current + 1; tick <= m_current + Slots; ++tick)
+	{
+		for (const auto &timer : m_slots[tick % Slots])
+			if (timer.deadline <= tick)
+				deadline = std::min(deadline, timer.deadline);
+		if (deadline != std::numeric_limits<Ticks>::max())
+			break;
+	}
+	if (deadline == std::numeric_limits<Ticks>::max())
+	{
+		for (const auto &entry : m_deadlines)
+			deadline = std::min(deadline, entry.second);
+	}
+	auto remaining = m_start + deadline*Tick - Clock::now();
+	auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(remaining).count();
+	// Round up, otherwise we would wake up just before the deadline.
+	return std::max(0, int(ms) + 1);
+}
+
+void TimerWheel::advance(Expired &expired)
+{
+	Ticks target = now();
+	if (target <= m_current)
+		return;
+	// If more than one revolution passed, every slot needs to be checked once.
+	Ticks first = std::max(m_current + 1, target > Slots ? target - Slots + 1 : 0);
+	std::vector<Timer> rescheduled;
+	for (Ticks tick = first; tick <= target; ++tick)
+	{
+		auto &slot = m_slots[tick % Slots];
+		auto it = std::partition(slot.begin(), slot.end(), [target](const Timer &t) {
+			return t.deadline > target;
+		});
+		for (auto jt = it; jt != slot.end(); ++jt)
+		{
+			expired.emplace_back(jt->id, jt->callback);
+			if (jt->interval > 0)
+			{
+				jt->deadline += jt->interval;
+				if (jt->deadline <= target)
+					jt->deadline = target + jt->interval;
+				rescheduled.push_back(std::move(*jt));
+			}
+			else
+				m_deadlines.erase(jt->id);
+		}
+		slot.erase(it, slot.end());
+	}
+	m_current = target;
+	for (auto &timer : rescheduled)
+		schedule(std::move(timer));
+}
+
+TimerWheel::Ticks TimerWheel::now() const
+{
+	return (Clock::now() - m_start) / Tick;
+}
+
+void TimerWheel::schedule(Timer timer)
+{
+	m_deadlines[timer.id] = timer.deadline;
+	m_slots[timer.deadline % Slots].push_back(std::move(timer));
+}
@@ -0,0 +1,87 @@
+/***************************************************************************
+ *   Copyright (C) 2008-2021 by Andrzej Rybczak                            *
+ *   andrzej@rybczak.net                                                   *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.              *
+ ***************************************************************************/
+
+#ifndef NCMPCPP_UTILITY_TIMER_WHEEL_H
+#define NCMPCPP_UTILITY_TIMER_WHEEL_H
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// Hashed timing wheel. Timers are put into slots by their deadlines rounded
+// up to ticks, so adding and cancelling a timer is O(1) and advancing the
+// wheel only looks at slots of ticks that passed.
+struct TimerWheel
+{
+	typedef std::chrono::steady_clock Clock;
+	typedef std::function<void()> Callback;
+	typedef uint64_t TimerID;
+	typedef std::vector<std::pair<TimerID, Callback>> Expired;
+
+	static const std::chrono::milliseconds Tick;
+	static const size_t Slots = 256;
+
+	TimerWheel();
+
+	// Schedules callback to be invoked after delay (and then every interval if
+	// it's positive). Returns non-zero identifier of the timer.
+	TimerID add(std::chrono::milliseconds delay, Callback callback,
+	            std::chrono::milliseconds interval = std::chrono::milliseconds(0));
+
+	// Cancels the timer. Does nothing if it already expired.
+	void cancel(TimerID id);
+
+	bool empty() const { return m_deadlines.empty(); }
+
+	// Returns number of milliseconds until the earliest deadline or -1 if
+	// there are no timers.
+	int timeout() const;
+
+	// Collects identifiers and callbacks of timers that expired up to now into
+	// expired and reschedules periodic ones. Periodic timers that missed
+	// several deadlines are fired only once.
+	void advance(Expired &expired);
+
+private:
+	typedef uint64_t Ticks;
+
+	struct Timer
+	{
+		TimerID id;
+		Ticks deadline;
+		Ticks interval;
+		Callback callback;
+	};
+
+	Ticks now() const;
+	void schedule(Timer timer);
+
+	Clock::time_point m_start;
+	Ticks m_current;
+	TimerID m_next_id;
+
+	std::vector<Timer> m_slots[Slots];
+	std::unordered_map<TimerID, Ticks> m_deadlines;
+};
+
+#endif // NCMPCPP_UTILITY_TIMER_WHEEL_H
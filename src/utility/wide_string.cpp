@@ -19,6 +19,7 @@
  ***************************************************************************/
 
 #include <cassert>
+#include <cstdint>
 #include "utility/wide_string.h"
 
 size_t wideLength(const std::wstring &ws)
@@ -84,3 +85,52 @@ std::wstring wideShorten(const std::wstring &ws, size_t max_length)
 	return result;
 }
 
+void utf8ToWide(std::wstring &ws, const std::string &s)
+{
+	ws.clear();
+	ws.reserve(s.size());
+	const unsigned char *it = reinterpret_cast<const unsigned char *>(s.data());
+	const unsigned char *end = it + s.size();
+	while (it != end)
+	{
+		uint32_t c = *it++;
+		if (c < 0x80)
+		{
+			ws += static_cast<wchar_t>(c);
+			continue;
+		}
+		size_t trailing;
+		if (c >= 0xc2 && c <= 0xdf)
+		{
+			trailing = 1;
+			c &= 0x1f;
+		}
+		else if (c >= 0xe0 && c <= 0xef)
+		{
+			trailing = 2;
+			c &= 0x0f;
+		}
+		else if (c >= 0xf0 && c <= 0xf4)
+		{
+			trailing = 3;
+			c &= 0x07;
+		}
+		else // invalid lead byte, skip it
+			continue;
+		if (static_cast<size_t>(end - it) < trailing)
+			break;
+		size_t i = 0;
+		for (; i < trailing && (it[i] & 0xc0) == 0x80; ++i)
+			c = (c << 6) | (it[i] & 0x3f);
+		it += i;
+		// skip truncated sequences, overlong encodings, surrogates
+		// and code points outside of unicode range.
+		if (i != trailing
+		    || (trailing == 2 && c < 0x800)
+		    || (trailing == 3 && c < 0x10000)
+		    || (c >= 0xd800 && c <= 0xdfff)
+		    || c > 0x10ffff)
+			continue;
+		ws += static_cast<wchar_t>(c);
+	}
+}
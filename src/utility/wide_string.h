@@ -35,6 +35,10 @@ std::wstring ToWString(StringT &&s)
 	return boost::locale::conv::utf_to_utf<wchar_t>(std::forward<StringT>(s));
 }
 
+// Decodes utf8 string directly into wide characters, reusing memory of the
+// output string. Invalid sequences are skipped.
+void utf8ToWide(std::wstring &ws, const std::string &s);
+
 size_t wideLength(const std::wstring &ws);
 void wideCut(std::wstring &ws, size_t max_length);
 